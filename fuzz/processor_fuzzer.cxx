@@ -0,0 +1,102 @@
+#include <hash.hxx>
+#include <machine.hxx>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+
+/**
+ * Edges between executed instructions, libFuzzer picks these up in addition to the coverage of the interpreter.
+ */
+__attribute__((used, section("__libfuzzer_extra_counters"))) std::uint8_t chip8_pc_edges[1u << 16];
+
+namespace {
+  /**
+   * Upper limit of instructions per input, so short inputs are executed at a high rate.
+   */
+  std::uint64_t constexpr MAX_CYCLES = 1024u;
+  /**
+   * Key events from the input are applied at this interval.
+   */
+  std::uint64_t constexpr KEY_INTERVAL = chip8::Processor::INPUT_BATCH;
+  std::size_t constexpr EDGE_MASK = sizeof(chip8_pc_edges)-1u;
+
+  bool halt_is_crash = false;
+
+  void record_edge(std::uint16_t const from, std::uint16_t const to) noexcept
+  {
+    auto& counter = chip8_pc_edges[chip8::mix64((static_cast<std::uint64_t>(from) << 16) | to) & EDGE_MASK];
+    if (counter!=0xFFu)
+      ++counter;
+  }
+
+  /**
+   * Run a single input on a machine, starting over from the state after construction.
+   */
+  template<typename Machine>
+  void run(Machine& machine, std::span<std::uint8_t const> const keys, std::span<std::uint8_t const> const rom)
+  {
+    machine.reset();
+    machine.load(rom);
+
+    auto& processor = machine.processor();
+    auto previous = static_cast<std::uint16_t>(processor.pc());
+    for (std::uint64_t cycle = 0u; cycle<MAX_CYCLES; ++cycle) {
+      if (cycle%KEY_INTERVAL==0u && cycle/KEY_INTERVAL<keys.size()) {
+        auto const key = keys[cycle/KEY_INTERVAL];
+        processor.toggle_key(static_cast<std::uint8_t>(key & 0xFu), (key & 0x10u)!=0u);
+        processor.process_input();
+      }
+
+      if (!machine.step()) {
+        // every instruction halting the processor counts as its own edge
+        record_edge(previous, 0xFFFFu);
+        if (halt_is_crash)
+          std::abort();
+        return;
+      }
+
+      auto const pc = static_cast<std::uint16_t>(processor.pc());
+      record_edge(previous, pc);
+      previous = pc;
+    }
+  }
+}
+
+extern "C" int LLVMFuzzerInitialize(int*, char***)
+{
+  // unsupported instructions are expected in random programs, they are only reported when asked for
+  halt_is_crash = std::getenv("CHIP8_FUZZ_HALT_IS_CRASH")!=nullptr;
+  return 0;
+}
+
+/**
+ * Input layout: one header byte, followed by the key events and the program.
+ *
+ * The lower two bits of the header select the quirk profile, the upper six bits the number of key events.
+ * Every key event byte holds the key in its lower nibble and whether it is pressed in bit 4.
+ */
+extern "C" int LLVMFuzzerTestOneInput(std::uint8_t const* data, std::size_t const size)
+{
+  if (size<1u)
+    return -1;
+
+  std::span const input{data, size};
+  auto const header = input[0];
+  auto const key_count = std::min<std::size_t>(header >> 2, input.size()-1u);
+  auto const keys = input.subspan(1u, key_count);
+  auto const rom = input.subspan(1u+key_count);
+  if (rom.size()>0x1000u-static_cast<std::uint16_t>(chip8::Processor::CODE_START))
+    return -1;
+
+  static chip8::NullLogger logger{};
+  auto const profile = static_cast<chip8::QuirkProfile>((header & 0x3u)%3u);
+  chip8::with_quirk_profile(profile, [&]<typename Quirks>(std::type_identity<Quirks>) {
+    // machines are created once and reset for every input
+    static chip8::BasicMachine<Quirks> machine{Quirks{}, logger};
+    run(machine, keys, rom);
+  });
+  return 0;
+}
@@ -24,4 +24,10 @@ TEST_CASE("Address", "[chip8][address]")
   SECTION("Addresses can be created from bigger values by truncation") {
     REQUIRE(Address{0xFEED, Address::Truncate{}}==0x0EED_addr);
   }
+
+  SECTION("Long addresses cover 16 bits and wrap around at their end") {
+    LongAddress const address{0xFFFF};
+    REQUIRE(static_cast<std::uint16_t>(address)==0xFFFF);
+    REQUIRE(address+1==LongAddress{0x0000});
+  }
 }
@@ -0,0 +1,56 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <beeper.hxx>
+
+#include <algorithm>
+#include <array>
+
+using namespace chip8;
+
+TEST_CASE("Beeper", "[chip8][beeper]")
+{
+  // one cycle per sample keeps the expected sample positions readable
+  Beeper beeper{48'000u};
+  beeper.set_output_format(48'000u, 64u);
+  std::array<std::int16_t, 64u> buffer{};
+
+  SECTION("Beeper is silent without events") {
+    beeper.render(buffer);
+    CHECK(std::ranges::all_of(buffer, [](auto const sample) { return sample==0; }));
+  }
+
+  SECTION("Events are played back sample accurately one buffer later") {
+    beeper.beeper(true, 1'000u);
+    beeper.beeper(false, 1'010u);
+
+    // the first event is scheduled one buffer after the current position
+    beeper.render(buffer);
+    CHECK(std::ranges::all_of(buffer, [](auto const sample) { return sample==0; }));
+
+    beeper.render(buffer);
+    CHECK(std::all_of(buffer.begin(), buffer.begin()+10, [](auto const sample) { return sample!=0; }));
+    CHECK(std::all_of(buffer.begin()+10, buffer.end(), [](auto const sample) { return sample==0; }));
+  }
+
+  SECTION("Events are placed at the speed the processor ran at") {
+    beeper.beeper(true, 1'000u);
+    beeper.set_speed(2u, 1'010u);
+    beeper.beeper(false, 1'030u);
+
+    beeper.render(buffer);
+    // 10 cycles at normal speed and 20 cycles at double speed
+    beeper.render(buffer);
+    CHECK(std::all_of(buffer.begin(), buffer.begin()+20, [](auto const sample) { return sample!=0; }));
+    CHECK(std::all_of(buffer.begin()+20, buffer.end(), [](auto const sample) { return sample==0; }));
+  }
+
+  SECTION("Events are played right away while running as fast as possible") {
+    beeper.set_speed(0u, 0u);
+    beeper.beeper(true, 1'000'000u);
+
+    // the speed change itself is played one buffer later
+    beeper.render(buffer);
+    beeper.render(buffer);
+    CHECK(std::ranges::all_of(buffer, [](auto const sample) { return sample!=0; }));
+  }
+}
@@ -9,9 +9,9 @@ TEST_CASE("CallStack", "[chip8][call_stack]")
   CallStack stack{};
 
   SECTION("Addresses can be pushed and popped") {
-    stack.push(0xBAD_addr);
+    CHECK(stack.push(0xBAD_addr));
     CHECK(stack.top()==0xBAD_addr);
-    stack.push(0xFEE_addr);
+    CHECK(stack.push(0xFEE_addr));
     CHECK(stack.top()==0xFEE_addr);
     CHECK(stack.pop()==0xFEE_addr);
     CHECK(stack.top()==0xBAD_addr);
@@ -21,7 +21,7 @@ TEST_CASE("CallStack", "[chip8][call_stack]")
   SECTION("Size and emptiness can be checked") {
     CHECK(stack.empty());
     CHECK(stack.size()==0); // NOLINT(*-container-size-empty)
-    stack.push(0xF00_addr);
+    CHECK(stack.push(0xF00_addr));
     CHECK(!stack.empty());
     CHECK(stack.size()==1);
     stack.pop();
@@ -33,4 +33,12 @@ TEST_CASE("CallStack", "[chip8][call_stack]")
     CHECK(!stack.top().has_value());
     CHECK(!stack.pop().has_value());
   }
+
+  SECTION("Pushing onto a full stack fails") {
+    for (std::size_t n = 0; n<CallStack::CAPACITY; ++n)
+      REQUIRE(stack.push(Address{static_cast<std::uint16_t>(n)}));
+    CHECK(!stack.push(0xF00_addr));
+    CHECK(stack.size()==CallStack::CAPACITY);
+    CHECK(stack.top()==Address{CallStack::CAPACITY-1u});
+  }
 }
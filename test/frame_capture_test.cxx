@@ -0,0 +1,124 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_exception.hpp>
+
+#include <frame_capture.hxx>
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace Catch::Matchers;
+using namespace chip8;
+
+namespace {
+  /**
+   * Frames resembling a game, with a sprite moving across a mostly static background.
+   */
+  std::vector<FrameBuffer> make_frames(std::size_t const count)
+  {
+    std::vector<FrameBuffer> frames(count);
+    for (std::size_t n = 0; n<count; ++n) {
+      auto& frame = frames[n];
+      frame.rows[31].high = ~0ull;
+      for (std::size_t y = 0; y<4u; ++y)
+        frame.rows[(n/64u+y)%30u].high |= 0xF000'0000'0000'0000ull >> (n%60u);
+      if (n%100u<3u)
+        frame = {};
+    }
+    return frames;
+  }
+}
+
+TEST_CASE("Frame capture", "[chip8][frame_capture]")
+{
+  auto const path = std::filesystem::temp_directory_path()/"chip8_frame_capture_test.c8fc";
+
+  SECTION("Frames can be written and read back") {
+    auto const frames = make_frames(1'000u);
+    {
+      FrameCaptureWriter writer{path};
+      for (auto const& frame: frames)
+        writer.capture(frame);
+      REQUIRE_NOTHROW(writer.close());
+    }
+
+    // delta encoding has to keep the capture far smaller than the raw frames
+    CHECK(std::filesystem::file_size(path)<frames.size()*sizeof(FrameBuffer)/8u);
+
+    FrameCaptureReader reader{path};
+    CHECK(reader.frame_count()==frames.size());
+    CHECK(reader.frame_rate()==FrameCaptureWriter::FRAME_RATE);
+    for (auto const& frame: frames) {
+      auto const read = reader.next();
+      REQUIRE(read.has_value());
+      CHECK(*read==frame);
+    }
+    CHECK(!reader.next().has_value());
+  }
+
+  SECTION("Frames keep their resolution") {
+    auto frames = make_frames(300u);
+    for (std::size_t n = 100u; n<200u; ++n) {
+      auto& frame = frames[n];
+      frame.high_resolution = true;
+      frame.rows[63] = PixelRow{.high = ~0ull, .low = ~0ull};
+      frame.rows[n%60u].low = 1ull << (n%64u);
+    }
+    {
+      FrameCaptureWriter writer{path};
+      for (auto const& frame: frames)
+        writer.capture(frame);
+    }
+
+    FrameCaptureReader reader{path};
+    for (auto const& frame: frames) {
+      auto const read = reader.next();
+      REQUIRE(read.has_value());
+      CHECK(*read==frame);
+    }
+    reader.seek(150u);
+    CHECK(reader.next()==frames[150]);
+  }
+
+  SECTION("Seeking decodes from the closest keyframe") {
+    auto const frames = make_frames(1'000u);
+    {
+      FrameCaptureWriter writer{path};
+      for (auto const& frame: frames)
+        writer.capture(frame);
+    }
+
+    FrameCaptureReader reader{path};
+    for (std::uint64_t const frame: {999u, 0u, 256u, 255u, 600u, 1u}) {
+      reader.seek(frame);
+      auto const read = reader.next();
+      REQUIRE(read.has_value());
+      CHECK(*read==frames[frame]);
+    }
+    REQUIRE_THROWS_MATCHES(reader.seek(frames.size()), CaptureException, Message("Frame does not exist"));
+  }
+
+  SECTION("Empty captures contain no frames") {
+    FrameCaptureWriter{path}.close();
+    FrameCaptureReader reader{path};
+    CHECK(reader.frame_count()==0u);
+    CHECK(!reader.next().has_value());
+  }
+
+  SECTION("Reading other files results in an exception") {
+    std::ofstream{path} << "not a capture";
+    REQUIRE_THROWS_MATCHES(FrameCaptureReader{path}, CaptureException, Message("Not a capture file"));
+  }
+
+  SECTION("Reading truncated captures results in an exception") {
+    {
+      FrameCaptureWriter writer{path};
+      writer.capture(FrameBuffer{});
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path)-1u);
+    REQUIRE_THROWS_MATCHES(FrameCaptureReader{path}, CaptureException,
+        Message("Capture file was not closed properly"));
+  }
+
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,101 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <input_latency.hxx>
+#include <processor.hxx>
+
+#include <array>
+#include <chrono>
+#include <sstream>
+#include <string>
+
+using namespace chip8;
+using namespace std::chrono_literals;
+
+namespace {
+  struct TestScreen final : Screen {
+    void clear() override
+    {
+    }
+
+    bool get_pixel(std::uint8_t, std::uint8_t) override
+    {
+      return false;
+    }
+
+    void set_pixel(std::uint8_t, std::uint8_t, bool) override
+    {
+    }
+
+    void set_high_resolution(bool) override
+    {
+    }
+
+    [[nodiscard]] bool high_resolution() const override
+    {
+      return false;
+    }
+  };
+
+  std::string report(InputLatencyTracer const& tracer)
+  {
+    std::ostringstream out{};
+    tracer.report(out);
+    return out.str();
+  }
+}
+
+TEST_CASE("InputLatencyTracer", "[chip8][input_latency]")
+{
+  InputLatencyTracer tracer{};
+  TestScreen screen{};
+  NullAudio audio{};
+  NullLogger logger{};
+  CallStack call_stack{};
+  Memory memory{};
+  // V0 = 5, skip unless key V0 pressed, I = font character of V0, draw it, loop forever
+  memory.load(Processor::CODE_START,
+      std::array<std::uint8_t, 10u>{0x60, 0x05, 0xE0, 0xA1, 0xF0, 0x29, 0xD0, 0x05, 0x12, 0x08});
+  BasicProcessor<quirks::Cosmac> processor{{}, call_stack, memory, screen, audio, logger};
+  processor.set_latency_tracer(&tracer);
+
+  SECTION("Key events are followed until the frame showing their effect is presented") {
+    REQUIRE(processor.toggle_key(0x5, true));
+    REQUIRE(processor.run(5u).reason==StopReason::BudgetExhausted);
+
+    auto const before_draw = std::chrono::steady_clock::time_point{};
+    tracer.presented(before_draw, std::chrono::steady_clock::now());
+    CHECK(report(tracer).starts_with("Input latency of 0 key events"));
+
+    auto const taken_at = std::chrono::steady_clock::now();
+    tracer.presented(taken_at, taken_at);
+    auto const text = report(tracer);
+    CHECK(text.starts_with("Input latency of 1 key events"));
+    for (auto const* const stage: {"apply", "observe", "draw", "present", "total"})
+      CHECK(text.contains(stage));
+  }
+
+  SECTION("Events nobody reads never complete") {
+    REQUIRE(processor.toggle_key(0x7, true));
+    REQUIRE(processor.run(5u).reason==StopReason::BudgetExhausted);
+    auto const taken_at = std::chrono::steady_clock::now();
+    tracer.presented(taken_at, taken_at);
+    CHECK(report(tracer).starts_with("Input latency of 0 key events"));
+  }
+
+  SECTION("Presenting lasts until the frame was shown") {
+    REQUIRE(processor.toggle_key(0x5, true));
+    REQUIRE(processor.run(5u).reason==StopReason::BudgetExhausted);
+
+    // a frontend waiting a second for the display
+    auto const taken_at = std::chrono::steady_clock::now();
+    tracer.presented(taken_at, taken_at+1s);
+    std::istringstream lines{report(tracer)};
+    std::string line{};
+    while (std::getline(lines, line) && !line.starts_with("present")) {
+    }
+    std::istringstream columns{line.substr(7u)};
+    double p50 = 0.0;
+    columns >> p50;
+    CHECK(p50>=1'000.0);
+  }
+}
@@ -0,0 +1,134 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <lockstep.hxx>
+
+#include <array>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace chip8;
+
+namespace {
+  Config constexpr COSMAC_CONFIG{
+      .register_rw_modifies_i = true,
+      .shift_takes_value_from_vy = true,
+      .use_vx_for_offset_jump = false,
+      .supports_high_resolution = false,
+  };
+
+  std::vector<std::uint8_t> read_rom(std::filesystem::path const& path)
+  {
+    std::ifstream file{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+  }
+
+  /**
+   * Number of instructions to verify every ROM for, CHIP8_LOCKSTEP_CYCLES allows longer nightly runs.
+   */
+  std::uint64_t lockstep_cycles()
+  {
+    if (auto const cycles = std::getenv("CHIP8_LOCKSTEP_CYCLES"); cycles!=nullptr)
+      return std::stoull(cycles);
+    return 100'000u;
+  }
+}
+
+TEST_CASE("Lockstep", "[chip8][lockstep]")
+{
+  NullLogger logger{};
+
+  SECTION("Runtime and compile time quirks agree on all ROMs") {
+    auto const cycles = lockstep_cycles();
+    for (auto const& entry: std::filesystem::directory_iterator{CHIP8_ASSETS_DIR}) {
+      if (entry.path().extension()!=".ch8")
+        continue;
+      INFO(entry.path().filename().string());
+
+      auto const rom = read_rom(entry.path());
+      Machine reference{COSMAC_CONFIG, logger, 1234u};
+      BasicMachine<quirks::Cosmac> candidate{quirks::Cosmac{}, logger, 1234u};
+      reference.load(rom);
+      candidate.load(rom);
+
+      Lockstep lockstep{reference, candidate};
+      // tap through all keys while running, to reach code behind key checks
+      std::uint8_t key = 0u;
+      for (std::uint64_t done = 0u; done<cycles; done += 4u*CYCLES_PER_TIMER_TICK) {
+        lockstep.toggle_key(key, true);
+        auto divergence = lockstep.run(2u*CYCLES_PER_TIMER_TICK);
+        if (!divergence.has_value()) {
+          lockstep.toggle_key(key, false);
+          divergence = lockstep.run(2u*CYCLES_PER_TIMER_TICK);
+        }
+        INFO((divergence.has_value() ? to_string(*divergence) : std::string{}));
+        REQUIRE_FALSE(divergence.has_value());
+        key = static_cast<std::uint8_t>((key+1u) & 0xFu);
+      }
+    }
+  }
+
+  SECTION("The first divergent instruction is reported") {
+    // V0 = 0x81, V1 = 0x02, V0 = V1 >> 1 (COSMAC) or V0 >> 1 (CHIP-48), then loop forever
+    std::vector<std::uint8_t> const program{0x60, 0x81, 0x61, 0x02, 0x80, 0x16, 0x12, 0x06};
+    BasicMachine<quirks::Cosmac> reference{quirks::Cosmac{}, logger};
+    BasicMachine<quirks::Chip48> candidate{quirks::Chip48{}, logger};
+    reference.load(program);
+    candidate.load(program);
+
+    Lockstep lockstep{reference, candidate, 1024u};
+    auto const divergence = lockstep.run(10'000u);
+    REQUIRE(divergence.has_value());
+    CHECK(divergence->reproducible);
+    CHECK(divergence->cycle==2u);
+    CHECK(divergence->pc==0x204_addr);
+    CHECK(divergence->opcode==0x8016u);
+    CHECK(divergence->reference.v[0]==0x01u);
+    CHECK(divergence->candidate.v[0]==0x40u);
+    CHECK(to_string(*divergence).starts_with("Engines diverge at instruction 0x8016 at 0x204 after 2 cycles"));
+  }
+
+  SECTION("A machine restored from a snapshot continues exactly like the original") {
+    auto const rom = read_rom(std::filesystem::path{CHIP8_ASSETS_DIR}/"caveexplorer.ch8");
+    Machine reference{COSMAC_CONFIG, logger, 42u};
+    reference.load(rom);
+    reference.advance(50'000u);
+
+    Machine copy{COSMAC_CONFIG, logger};
+    copy.restore(reference.snapshot());
+    REQUIRE(copy.digest()==reference.digest());
+
+    Lockstep lockstep{reference, copy};
+    auto const divergence = lockstep.run(100'000u);
+    INFO((divergence.has_value() ? to_string(*divergence) : std::string{}));
+    REQUIRE_FALSE(divergence.has_value());
+  }
+
+  SECTION("Different seeds are caught") {
+    // V0 = random, then loop forever
+    std::vector<std::uint8_t> const program{0xC0, 0xFF, 0x12, 0x02};
+    std::array<std::uint8_t, 2u> drawn{};
+    for (std::uint32_t const seed: {1u, 2u}) {
+      Machine machine{COSMAC_CONFIG, logger, seed};
+      machine.load(program);
+      machine.advance(1u);
+      drawn[seed-1u] = machine.processor().state().v[0];
+    }
+    REQUIRE(drawn[0]!=drawn[1]);
+
+    Machine reference{COSMAC_CONFIG, logger, 1u};
+    Machine candidate{COSMAC_CONFIG, logger, 2u};
+    reference.load(program);
+    candidate.load(program);
+
+    Lockstep lockstep{reference, candidate};
+    auto const divergence = lockstep.run(1'000u);
+    REQUIRE(divergence.has_value());
+    CHECK(divergence->cycle==0u);
+    CHECK(divergence->reference.v[0]==drawn[0]);
+    CHECK(divergence->candidate.v[0]==drawn[1]);
+  }
+}
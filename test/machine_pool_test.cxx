@@ -0,0 +1,117 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <machine_pool.hxx>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+using namespace chip8;
+
+namespace {
+  std::vector<std::uint8_t> read_rom(std::filesystem::path const& path)
+  {
+    std::ifstream file{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+  }
+
+  MachineDigest fresh_digest(std::vector<std::uint8_t> const& rom, std::uint64_t const cycles)
+  {
+    NullLogger logger{};
+    BasicMachine<quirks::Cosmac> machine{quirks::Cosmac{}, logger, 7u};
+    machine.load(rom);
+    machine.advance(cycles);
+    return machine.digest();
+  }
+}
+
+TEST_CASE("MachinePool", "[chip8][machine_pool]")
+{
+  NullLogger logger{};
+  auto const rom = read_rom(std::filesystem::path{CHIP8_ASSETS_DIR}/"caveexplorer.ch8");
+  std::vector<std::uint8_t> const loop{0x60, 0x01, 0x12, 0x02};
+  BasicMachinePool<quirks::Cosmac> pool{quirks::Cosmac{}, logger, 1u, 7u};
+
+  SECTION("Machines from the pool run like new ones") {
+    auto lease = pool.acquire(rom, 7u);
+    REQUIRE(lease.has_value());
+    (*lease)->advance(30'000u);
+    REQUIRE((*lease)->digest()==fresh_digest(rom, 30'000u));
+  }
+
+  SECTION("Released machines are handed out clean") {
+    {
+      auto lease = pool.acquire(rom);
+      REQUIRE(lease.has_value());
+      (*lease)->advance(30'000u);
+      (*lease)->processor().set_breakpoint(0x202_addr);
+    }
+
+    auto lease = pool.acquire(loop);
+    REQUIRE(lease.has_value());
+    REQUIRE((*lease)->digest()==fresh_digest(loop, 0u));
+    REQUIRE((*lease)->processor().run(100u).reason==StopReason::BudgetExhausted);
+  }
+
+  SECTION("Sessions get different random numbers") {
+    std::vector<std::uint8_t> const random{0xC0, 0xFF, 0xC1, 0xFF, 0xC2, 0xFF, 0xC3, 0xFF, 0xC4, 0xFF, 0xC5, 0xFF};
+    auto first = pool.acquire(random);
+    REQUIRE(first.has_value());
+    (*first)->advance(6u);
+    auto const drawn = (*first)->processor().state().v;
+    first->release();
+
+    auto second = pool.acquire(random);
+    REQUIRE(second.has_value());
+    (*second)->advance(6u);
+    REQUIRE((*second)->processor().state().v!=drawn);
+  }
+
+  SECTION("An exhausted pool hands out nothing") {
+    auto lease = pool.acquire(rom);
+    REQUIRE(lease.has_value());
+    REQUIRE_FALSE(pool.acquire(rom).has_value());
+    lease->release();
+    REQUIRE(pool.acquire(rom).has_value());
+  }
+
+  SECTION("Machines stay in the pool if the program does not fit") {
+    std::vector<std::uint8_t> const oversized(0x1000u, 0x00u);
+    REQUIRE_THROWS_AS(pool.acquire(oversized), MemoryOverflowException);
+    REQUIRE(pool.acquire(rom).has_value());
+  }
+
+  SECTION("Threads share the machines") {
+    BasicMachinePool<quirks::Cosmac> shared{quirks::Cosmac{}, logger, 2u, 7u};
+    auto const expected = fresh_digest(loop, 1'000u);
+    std::atomic<unsigned> sessions{0u};
+    std::atomic<bool> mismatch{false};
+
+    std::vector<std::thread> threads{};
+    for (int n = 0; n<4; ++n) {
+      threads.emplace_back([&] {
+        for (int session = 0; session<1'000; ++session) {
+          auto lease = shared.acquire(loop);
+          if (!lease.has_value())
+            continue;
+          (*lease)->advance(1'000u);
+          if ((*lease)->digest()!=expected)
+            mismatch = true;
+          ++sessions;
+        }
+      });
+    }
+    for (auto& thread: threads)
+      thread.join();
+
+    REQUIRE_FALSE(mismatch);
+    REQUIRE(sessions>0u);
+    auto first = shared.acquire(loop);
+    auto second = shared.acquire(loop);
+    REQUIRE(first.has_value());
+    REQUIRE(second.has_value());
+  }
+}
@@ -0,0 +1,63 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <machine.hxx>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace chip8;
+
+namespace {
+  std::vector<std::uint8_t> read_rom(std::filesystem::path const& path)
+  {
+    std::ifstream file{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+  }
+}
+
+TEST_CASE("Machine", "[chip8][machine]")
+{
+  NullLogger logger{};
+  auto const rom = read_rom(std::filesystem::path{CHIP8_ASSETS_DIR}/"caveexplorer.ch8");
+  BasicMachine<quirks::Cosmac> machine{quirks::Cosmac{}, logger, 7u};
+  machine.load(rom);
+  machine.save_baseline();
+  auto const baseline = machine.digest();
+
+  SECTION("Reset returns to the baseline") {
+    machine.advance(30'000u);
+    REQUIRE(machine.digest()!=baseline);
+    machine.reset();
+    REQUIRE(machine.digest()==baseline);
+    REQUIRE(machine.processor().cycles()==0u);
+  }
+
+  SECTION("A reset machine runs exactly like a new one") {
+    machine.advance(30'000u);
+    machine.reset();
+    machine.advance(30'000u);
+
+    BasicMachine<quirks::Cosmac> fresh{quirks::Cosmac{}, logger, 7u};
+    fresh.load(rom);
+    fresh.advance(30'000u);
+    REQUIRE(machine.digest()==fresh.digest());
+  }
+
+  SECTION("Reset drops pending input") {
+    machine.processor().toggle_key(0x5, true);
+    machine.reset();
+    machine.processor().process_input();
+    REQUIRE(machine.processor().state().keys==0u);
+  }
+
+  SECTION("Machines halt on unsupported instructions") {
+    BasicMachine<quirks::Cosmac> broken{quirks::Cosmac{}, logger};
+    broken.load(std::vector<std::uint8_t>{0x60, 0x01, 0xFF, 0xFF});
+    REQUIRE(broken.advance(100u)==2u);
+    REQUIRE(broken.halted());
+    broken.reset();
+    REQUIRE_FALSE(broken.halted());
+  }
+}
@@ -10,8 +10,8 @@ TEST_CASE("Memory", "[chip8][memory]")
 {
   Memory mem{};
 
-  SECTION("Memory is 4kiB in size") {
-    REQUIRE(sizeof(Memory)==4096u);
+  SECTION("Memory is 4kiB in size plus a little bookkeeping") {
+    REQUIRE(sizeof(Memory)<=4096u+32u);
   }
 
   SECTION("Memory is zero filled by default") {
@@ -37,4 +37,81 @@ TEST_CASE("Memory", "[chip8][memory]")
     REQUIRE_THROWS_MATCHES(mem.load(0xFFF_addr, data), MemoryOverflowException,
         Message("Trying to load more data than fits in memory"));
   }
+
+  SECTION("Digest of zero filled memory is zero") {
+    REQUIRE(mem.digest()==0u);
+  }
+
+  SECTION("Digest follows the memory contents") {
+    mem.write(0x300_addr, 0x12);
+    auto const digest = mem.digest();
+    CHECK(digest!=0u);
+
+    mem.write(0x300_addr, 0x34);
+    CHECK(mem.digest()!=digest);
+    mem.write(0x300_addr, 0x12);
+    CHECK(mem.digest()==digest);
+
+    Memory other{};
+    other.load(0x300_addr, std::ranges::single_view{0x12});
+    CHECK(other.digest()==digest);
+
+    mem.write(0x300_addr, 0x00);
+    CHECK(mem.digest()==0u);
+  }
+
+  SECTION("Digest depends on the address") {
+    Memory other{};
+    mem.write(0x300_addr, 0x12);
+    other.write(0x301_addr, 0x12);
+    REQUIRE(mem.digest()!=other.digest());
+  }
+
+  SECTION("Reverting restores the baseline") {
+    mem.load(0x200_addr, std::array<std::uint8_t, 3u>{1u, 2u, 3u});
+    mem.mark_clean();
+    Memory const baseline = mem;
+
+    mem.write(0x201_addr, 0x42);
+    mem.write(0xFFF_addr, 0x17);
+    mem.write(0x000_addr, 0x01);
+    REQUIRE(mem.digest()!=baseline.digest());
+
+    mem.revert(baseline);
+    CHECK(mem.digest()==baseline.digest());
+    for (std::uint16_t n = 0x0; n<0x1000u; ++n) {
+      Address const address{n};
+      CHECK(mem[address]==baseline[address]);
+    }
+  }
+}
+
+TEST_CASE("ExtendedMemory", "[chip8][memory]")
+{
+  ExtendedMemory mem{};
+
+  SECTION("Extended memory is 64kiB in size plus a little bookkeeping") {
+    REQUIRE(sizeof(ExtendedMemory)<=65536u+256u);
+  }
+
+  SECTION("Data can be loaded to the end of extended memory") {
+    REQUIRE_NOTHROW(mem.load(LongAddress{0xFFFE}, std::array<std::uint8_t, 2u>{23, 42}));
+    CHECK(mem[LongAddress{0xFFFF}]==42);
+    REQUIRE_THROWS_MATCHES(mem.load(LongAddress{0xFFFF}, std::array<std::uint8_t, 2u>{23, 42}),
+        MemoryOverflowException, Message("Trying to load more data than fits in memory"));
+  }
+
+  SECTION("Reverting restores the baseline beyond 4kiB") {
+    mem.mark_clean();
+    ExtendedMemory const baseline = mem;
+
+    mem.write(LongAddress{0x1000}, 0x42);
+    mem.write(LongAddress{0xFFFF}, 0x17);
+    REQUIRE(mem.digest()!=baseline.digest());
+
+    mem.revert(baseline);
+    CHECK(mem.digest()==baseline.digest());
+    CHECK(mem[LongAddress{0x1000}]==0u);
+    CHECK(mem[LongAddress{0xFFFF}]==0u);
+  }
 }
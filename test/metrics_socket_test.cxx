@@ -0,0 +1,48 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <metrics_socket.hxx>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace chip8;
+
+TEST_CASE("MetricsSocketExporter", "[chip8][metrics]")
+{
+  auto const path = std::filesystem::temp_directory_path()/"chip8_metrics_test.sock";
+  MetricsRegistry registry{};
+  registry.counter("test_total", "Test counter.").add(42u);
+  MetricsSocketExporter const exporter{registry, path};
+
+  SECTION("Every connection receives the metrics") {
+    for (int n = 0; n<2; ++n) {
+      sockaddr_un address{};
+      address.sun_family = AF_UNIX;
+      std::strcpy(address.sun_path, path.c_str());
+      auto const fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      REQUIRE(fd>=0);
+      REQUIRE(connect(fd, reinterpret_cast<sockaddr const*>(&address), sizeof(address))==0);
+
+      std::string text{};
+      char buffer[256];
+      for (ssize_t count; (count = read(fd, buffer, sizeof(buffer)))>0;)
+        text.append(buffer, static_cast<std::size_t>(count));
+      close(fd);
+      CHECK(text==registry.text());
+    }
+  }
+
+  SECTION("Files in the way are left alone") {
+    auto const file = std::filesystem::temp_directory_path()/"chip8_metrics_test.prom";
+    std::ofstream{file} << "keep";
+    REQUIRE_THROWS_AS((MetricsSocketExporter{registry, file}), MetricsException);
+    REQUIRE(std::filesystem::is_regular_file(file));
+    std::filesystem::remove(file);
+  }
+}
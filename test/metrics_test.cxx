@@ -0,0 +1,79 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <metrics.hxx>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace chip8;
+using namespace std::chrono_literals;
+
+TEST_CASE("Metrics", "[chip8][metrics]")
+{
+  MetricsRegistry registry{};
+
+  SECTION("Counters sum up the updates of all threads") {
+    auto& counter = registry.counter("test_total", "Test counter.");
+    std::vector<std::thread> threads{};
+    for (int n = 0; n<4; ++n) {
+      threads.emplace_back([&counter] {
+        for (int m = 0; m<1000; ++m)
+          counter.add();
+      });
+    }
+    for (auto& thread: threads)
+      thread.join();
+    counter.add(5u);
+    CHECK(counter.value()==4005u);
+  }
+
+  SECTION("Histograms count durations into buckets") {
+    auto& histogram = registry.histogram("test_seconds", "Test histogram.");
+    histogram.observe(10ns);
+    histogram.observe(64ns);
+    histogram.observe(65ns);
+    histogram.observe(1ms);
+    histogram.observe(10s);
+
+    auto const snapshot = histogram.snapshot();
+    CHECK(snapshot.count==5u);
+    CHECK(snapshot.sum==10s+1ms+139ns);
+    CHECK(snapshot.buckets[0]==2u);
+    CHECK(snapshot.buckets[1]==1u);
+    CHECK(snapshot.buckets[7]==1u);
+    CHECK(snapshot.buckets[Histogram::BUCKETS-1u]==1u);
+    CHECK(Histogram::upper_bound(7)>=1'000'000u);
+  }
+
+  SECTION("Metrics are rendered in the Prometheus text format") {
+    registry.counter("test_total", "Test counter.").add(3u);
+    registry.gauge("test_drift_seconds", "Test gauge.").set(-500ms);
+    registry.histogram("test_seconds", "Test histogram.").observe(100ns);
+
+    auto const text = registry.text();
+    CHECK(text.contains("# HELP test_total Test counter.\n# TYPE test_total counter\ntest_total 3\n"));
+    CHECK(text.contains("# TYPE test_drift_seconds gauge\ntest_drift_seconds -0.5\n"));
+    CHECK(text.contains("test_seconds_bucket{le=\"6.4e-08\"} 0\n"));
+    CHECK(text.contains("test_seconds_bucket{le=\"2.56e-07\"} 1\n"));
+    CHECK(text.contains("test_seconds_bucket{le=\"+Inf\"} 1\ntest_seconds_sum 1e-07\ntest_seconds_count 1\n"));
+  }
+
+  SECTION("The file exporter writes the metrics when it stops") {
+    auto const path = std::filesystem::temp_directory_path()/"chip8_metrics_test.prom";
+    auto& counter = registry.counter("test_total", "Test counter.");
+    {
+      MetricsFileExporter const exporter{registry, path, 1h};
+      counter.add(7u);
+    }
+
+    std::ifstream file{path};
+    std::string const text{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    CHECK(text==registry.text());
+    CHECK(text.contains("test_total 7\n"));
+    std::filesystem::remove(path);
+  }
+}
@@ -0,0 +1,103 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <packed_screen.hxx>
+
+#include <array>
+
+using namespace chip8;
+
+TEST_CASE("PackedScreen", "[chip8][packed_screen]")
+{
+  PackedScreen screen{};
+
+  SECTION("Pixels are packed with the leftmost pixel in the most significant bit") {
+    screen.set_pixel(0, 1, true);
+    screen.set_pixel(63, 1, true);
+    CHECK(screen.get_pixel(0, 1));
+    CHECK(screen.get_pixel(63, 1));
+    CHECK(!screen.get_pixel(1, 1));
+    CHECK(screen.frame().rows[1]==PixelRow{.high = 0x8000'0000'0000'0001u});
+  }
+
+  SECTION("Pixels of the high resolution are packed into the second half of a row") {
+    screen.set_high_resolution(true);
+    screen.set_pixel(64, 40, true);
+    screen.set_pixel(127, 40, true);
+    CHECK(screen.get_pixel(127, 40));
+    CHECK(screen.frame().rows[40]==PixelRow{.low = 0x8000'0000'0000'0001u});
+  }
+
+  SECTION("Sprites are XORed onto the screen and report collisions") {
+    std::array<std::uint16_t, 2u> const sprite{0xF000u, 0x9000u};
+    CHECK(!screen.draw_sprite(2, 3, sprite));
+    CHECK(screen.frame().rows[3]==PixelRow{.high = 0x3C00'0000'0000'0000u});
+    CHECK(screen.frame().rows[4]==PixelRow{.high = 0x2400'0000'0000'0000u});
+
+    CHECK(screen.draw_sprite(4, 3, std::array<std::uint16_t, 1u>{0xC000u}));
+    CHECK(screen.frame().rows[3]==PixelRow{.high = 0x3000'0000'0000'0000u});
+  }
+
+  SECTION("Sprites are clipped at the edges of the current resolution") {
+    std::array<std::uint16_t, 2u> const sprite{0xFFFFu, 0xFFFFu};
+    CHECK(!screen.draw_sprite(60, 31, sprite));
+    CHECK(screen.frame().rows[31]==PixelRow{.high = 0xFu});
+    CHECK(!screen.get_pixel(0, 0));
+
+    screen.set_high_resolution(true);
+    CHECK(!screen.draw_sprite(120, 63, sprite));
+    CHECK(screen.frame().rows[63]==PixelRow{.low = 0xFFu});
+  }
+
+  SECTION("Sprites can straddle both halves of a row") {
+    screen.set_high_resolution(true);
+    CHECK(!screen.draw_sprite(56, 0, std::array<std::uint16_t, 1u>{0xFFFFu}));
+    CHECK(screen.frame().rows[0]==PixelRow{.high = 0xFFu, .low = 0xFF00'0000'0000'0000u});
+  }
+
+  SECTION("Scrolling moves the whole screen") {
+    screen.set_high_resolution(true);
+    screen.set_pixel(0, 0, true);
+    screen.set_pixel(126, 63, true);
+
+    screen.scroll_down(2);
+    CHECK(screen.get_pixel(0, 2));
+    CHECK(!screen.get_pixel(126, 63));
+
+    screen.scroll_right();
+    CHECK(screen.get_pixel(4, 2));
+
+    screen.scroll_left();
+    screen.scroll_left();
+    CHECK(screen.frame()==FrameBuffer{.high_resolution = true});
+  }
+
+  SECTION("Scrolling in the low resolution stays within its pixels") {
+    screen.set_pixel(62, 0, true);
+    screen.scroll_right();
+    CHECK(screen.frame()==FrameBuffer{});
+  }
+
+  SECTION("Switching the resolution clears the screen") {
+    screen.set_pixel(5, 5, true);
+    screen.set_high_resolution(true);
+    CHECK(screen.high_resolution());
+    CHECK(screen.width()==Screen::HIRES_WIDTH);
+    CHECK(screen.frame()==FrameBuffer{.high_resolution = true});
+
+    screen.set_high_resolution(false);
+    CHECK(screen.height()==Screen::HEIGHT);
+    CHECK(screen.frame()==FrameBuffer{});
+  }
+
+  SECTION("Clearing the screen turns off all pixels") {
+    screen.set_pixel(5, 5, true);
+    screen.clear();
+    CHECK(screen.frame()==FrameBuffer{});
+  }
+
+  SECTION("Every change bumps the version") {
+    auto const version = screen.version();
+    screen.set_pixel(1, 2, true);
+    CHECK(screen.version()>version);
+  }
+}
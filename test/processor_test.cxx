@@ -0,0 +1,395 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <processor.hxx>
+
+#include <algorithm>
+#include <array>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+using namespace chip8;
+
+namespace {
+  struct TestScreen final : Screen {
+    std::array<std::array<bool, HIRES_WIDTH>, HIRES_HEIGHT> pixels{};
+    bool high{false};
+
+    void clear() override
+    {
+      pixels = {};
+    }
+
+    bool get_pixel(std::uint8_t const x, std::uint8_t const y) override
+    {
+      return pixels[y][x];
+    }
+
+    void set_pixel(std::uint8_t const x, std::uint8_t const y, bool const state) override
+    {
+      pixels[y][x] = state;
+    }
+
+    void set_high_resolution(bool const enabled) override
+    {
+      high = enabled;
+      clear();
+    }
+
+    [[nodiscard]] bool high_resolution() const override
+    {
+      return high;
+    }
+  };
+
+  struct TestLogger final : Logger {
+    void debug(char const*, std::source_location) override
+    {
+    }
+
+    void warn(char const*, std::source_location) override
+    {
+    }
+
+    void error(char const*, std::source_location) override
+    {
+    }
+  };
+
+  struct TestAudio final : Audio {
+    std::vector<std::pair<bool, std::uint64_t>> events{};
+
+    void beeper(bool const on, std::uint64_t const cycle) override
+    {
+      events.emplace_back(on, cycle);
+    }
+  };
+
+  /**
+   * Run a program on the given screen and memory, which hold the results afterwards.
+   */
+  template<QuirkSet Quirks>
+  void run_on(Quirks const& quirks, TestScreen& screen, Memory& memory, std::vector<std::uint8_t> const& program)
+  {
+    NullAudio audio{};
+    TestLogger logger{};
+    CallStack call_stack{};
+    memory.load(BasicProcessor<Quirks>::CODE_START, program);
+    BasicProcessor<Quirks> processor{quirks, call_stack, memory, screen, audio, logger};
+    for (std::size_t n = 0; n<program.size()/2u; ++n)
+      REQUIRE(processor.step());
+  }
+
+  /**
+   * A COSMAC VIP processor with everything it runs on, the program loaded at the start of the code.
+   */
+  struct TestMachine final {
+    TestScreen screen{};
+    NullAudio audio{};
+    TestLogger logger{};
+    CallStack call_stack{};
+    Memory memory{};
+    BasicProcessor<quirks::Cosmac> processor{{}, call_stack, memory, screen, audio, logger};
+
+    explicit TestMachine(std::vector<std::uint8_t> const& program)
+    {
+      memory.load(Processor::CODE_START, program);
+    }
+  };
+
+  /**
+   * Run a program and return V0 afterwards, which the programs use as their result register.
+   */
+  template<QuirkSet Quirks>
+  std::uint8_t run(Quirks const& quirks, std::vector<std::uint8_t> const& program)
+  {
+    TestScreen screen{};
+    Memory memory{};
+    run_on(quirks, screen, memory, program);
+    return memory[0x300_addr];
+  }
+
+  std::size_t lit_pixels(TestScreen const& screen)
+  {
+    std::size_t count = 0u;
+    for (auto const& row: screen.pixels)
+      count += static_cast<std::size_t>(std::ranges::count(row, true));
+    return count;
+  }
+
+  // V1 = 0x81, V2 = 0x02, V0 = V1 >> 1 or V2 >> 1, store V0 to 0x300
+  std::vector<std::uint8_t> const SHIFT_PROGRAM{0x61, 0x81, 0x62, 0x02, 0x80, 0x26, 0xA3, 0x00, 0xF0, 0x55};
+  // V0 = 1, I = 0x300, store V0, V0 = 2, store V0 again (ending up at 0x301 if I was incremented)
+  std::vector<std::uint8_t> const STORE_PROGRAM{0x60, 0x01, 0xA3, 0x00, 0xF0, 0x55, 0x60, 0x02, 0xF0, 0x55};
+  // high resolution, V0 = 120, V1 = 56, I = 0x400, draw a 16x16 sprite at V0/V1
+  std::vector<std::uint8_t> const LARGE_SPRITE_PROGRAM{0x00, 0xFF, 0x60, 0x78, 0x61, 0x38, 0xA4, 0x00, 0xD0, 0x10};
+}
+
+TEST_CASE("Processor", "[chip8][processor]")
+{
+  SECTION("Shift takes its value from VY on the COSMAC VIP") {
+    CHECK(run(quirks::Cosmac{}, SHIFT_PROGRAM)==0x01);
+  }
+
+  SECTION("Shift takes its value from VX on CHIP-48 and SUPER-CHIP") {
+    CHECK(run(quirks::Chip48{}, SHIFT_PROGRAM)==0x00);
+    CHECK(run(quirks::SuperChip{}, SHIFT_PROGRAM)==0x00);
+  }
+
+  SECTION("Storing registers increments I on the COSMAC VIP only") {
+    CHECK(run(quirks::Cosmac{}, STORE_PROGRAM)==0x01);
+    CHECK(run(quirks::Chip48{}, STORE_PROGRAM)==0x02);
+  }
+
+  SECTION("Sound timer turns the beeper on and off") {
+    TestScreen screen{};
+    TestAudio audio{};
+    TestLogger logger{};
+    CallStack call_stack{};
+    Memory memory{};
+    // V0 = 2, sound timer = V0, V1 = 0
+    memory.load(Processor::CODE_START, std::array<std::uint8_t, 6u>{0x60, 0x02, 0xF0, 0x18, 0x61, 0x00});
+    BasicProcessor<quirks::Cosmac> processor{{}, call_stack, memory, screen, audio, logger};
+
+    REQUIRE(processor.step());
+    REQUIRE(processor.step());
+    CHECK(audio.events==std::vector<std::pair<bool, std::uint64_t>>{{true, 2u}});
+
+    processor.update_timers();
+    processor.update_timers();
+    REQUIRE(processor.step());
+    CHECK(processor.cycles()==3u);
+    CHECK(audio.events==std::vector<std::pair<bool, std::uint64_t>>{{true, 2u}, {false, 3u}});
+  }
+
+  SECTION("Key events are applied between instructions") {
+    TestScreen screen{};
+    NullAudio audio{};
+    TestLogger logger{};
+    CallStack call_stack{};
+    Memory memory{};
+    // V0 = 5, skip if key V0 pressed, V1 = 1, I = 0x300, store V0-V1
+    memory.load(Processor::CODE_START,
+        std::array<std::uint8_t, 10u>{0x60, 0x05, 0xE0, 0x9E, 0x61, 0x01, 0xA3, 0x00, 0xF1, 0x55});
+    BasicProcessor<quirks::Cosmac> processor{{}, call_stack, memory, screen, audio, logger};
+
+    REQUIRE(processor.toggle_key(0x5, true));
+    CHECK(!processor.toggle_key(0x10, true));
+    for (int n = 0; n<4; ++n)
+      REQUIRE(processor.step());
+    CHECK(memory[0x300_addr]==5);
+    CHECK(memory[0x301_addr]==0);
+    CHECK(processor.applied_input()->applied_cycle==0u);
+  }
+
+  SECTION("Waiting for a key completes once it is released") {
+    TestScreen screen{};
+    NullAudio audio{};
+    TestLogger logger{};
+    CallStack call_stack{};
+    Memory memory{};
+    // wait for key into V3, I = 0x300, store V0-V3
+    memory.load(Processor::CODE_START, std::array<std::uint8_t, 6u>{0xF3, 0x0A, 0xA3, 0x00, 0xF3, 0x55});
+    BasicProcessor<quirks::Cosmac> processor{{}, call_stack, memory, screen, audio, logger};
+
+    for (int n = 0; n<10; ++n)
+      REQUIRE(processor.step());
+
+    REQUIRE(processor.toggle_key(0xB, true));
+    REQUIRE(processor.toggle_key(0xB, false));
+    processor.process_input();
+
+    auto const pressed = processor.applied_input();
+    REQUIRE(pressed.has_value());
+    CHECK(pressed->key==0xB);
+    CHECK(pressed->pressed);
+    CHECK(pressed->applied_cycle==10u);
+    auto const released = processor.applied_input();
+    REQUIRE(released.has_value());
+    CHECK(!released->pressed);
+    CHECK(released->queued_at>=pressed->queued_at);
+
+    REQUIRE(processor.step());
+    REQUIRE(processor.step());
+    REQUIRE(processor.step());
+    CHECK(memory[0x303_addr]==0xB);
+  }
+
+  SECTION("Runtime configuration behaves like the compile time profiles") {
+    Config const cosmac{
+        .register_rw_modifies_i = true,
+        .shift_takes_value_from_vy = true,
+        .use_vx_for_offset_jump = false,
+        .supports_high_resolution = false,
+    };
+    Config const chip48{
+        .register_rw_modifies_i = false,
+        .shift_takes_value_from_vy = false,
+        .use_vx_for_offset_jump = true,
+        .supports_high_resolution = false,
+    };
+    CHECK(run(cosmac, SHIFT_PROGRAM)==run(quirks::Cosmac{}, SHIFT_PROGRAM));
+    CHECK(run(cosmac, STORE_PROGRAM)==run(quirks::Cosmac{}, STORE_PROGRAM));
+    CHECK(run(chip48, SHIFT_PROGRAM)==run(quirks::Chip48{}, SHIFT_PROGRAM));
+    CHECK(run(chip48, STORE_PROGRAM)==run(quirks::Chip48{}, STORE_PROGRAM));
+  }
+
+  SECTION("SUPER-CHIP draws 16x16 sprites in the high resolution, clipped at the edges") {
+    TestScreen screen{};
+    Memory memory{};
+    memory.load(0x400_addr, std::array<std::uint8_t, 32u>{
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+    run_on(quirks::SuperChip{}, screen, memory, LARGE_SPRITE_PROGRAM);
+
+    CHECK(screen.high);
+    CHECK(screen.pixels[56][120]);
+    CHECK(screen.pixels[63][127]);
+    CHECK(!screen.pixels[55][120]);
+    CHECK(!screen.pixels[56][119]);
+    CHECK(lit_pixels(screen)==64u);
+  }
+
+  SECTION("Drawing over lit pixels sets VF in the high resolution") {
+    TestScreen screen{};
+    Memory memory{};
+    memory.load(0x400_addr, std::array<std::uint8_t, 2u>{0x80, 0x01});
+    auto program = LARGE_SPRITE_PROGRAM;
+    // draw again, I = 0x300, store V0-VF
+    program.insert(program.end(), {0xD0, 0x10, 0xA3, 0x00, 0xFF, 0x55});
+    run_on(quirks::SuperChip{}, screen, memory, program);
+
+    CHECK(memory[0x30F_addr]==1u);
+    CHECK(lit_pixels(screen)==0u);
+  }
+
+  SECTION("SUPER-CHIP scrolls the screen") {
+    TestScreen screen{};
+    Memory memory{};
+    memory.load(0x400_addr, std::ranges::single_view<std::uint8_t>{0x80});
+    // high resolution, V0 = 0, I = 0x400, draw a pixel at 0/0, scroll down 3 rows, right, right, left
+    run_on(quirks::SuperChip{}, screen, memory,
+        {0x00, 0xFF, 0x60, 0x00, 0xA4, 0x00, 0xD0, 0x01, 0x00, 0xC3, 0x00, 0xFB, 0x00, 0xFB, 0x00, 0xFC});
+
+    CHECK(screen.pixels[3][4]);
+    CHECK(lit_pixels(screen)==1u);
+  }
+
+  SECTION("Switching back to the low resolution clears the screen") {
+    TestScreen screen{};
+    Memory memory{};
+    memory.load(0x400_addr, std::ranges::single_view<std::uint8_t>{0x80});
+    auto program = LARGE_SPRITE_PROGRAM;
+    program.insert(program.end(), {0x00, 0xFE});
+    run_on(quirks::SuperChip{}, screen, memory, program);
+
+    CHECK(!screen.high);
+    CHECK(lit_pixels(screen)==0u);
+  }
+
+  SECTION("The COSMAC VIP does not know the high resolution") {
+    TestScreen screen{};
+    NullAudio audio{};
+    TestLogger logger{};
+    CallStack call_stack{};
+    Memory memory{};
+    memory.load(Processor::CODE_START, std::array<std::uint8_t, 2u>{0x00, 0xFF});
+    BasicProcessor<quirks::Cosmac> processor{{}, call_stack, memory, screen, audio, logger};
+
+    CHECK(!processor.step());
+    CHECK(!screen.high);
+  }
+
+  SECTION("Sprites of size 0 draw nothing on the COSMAC VIP") {
+    TestScreen screen{};
+    Memory memory{};
+    memory.load(0x400_addr, std::ranges::single_view<std::uint8_t>{0xFF});
+    // V0 = 0, I = 0x400, draw a sprite of size 0
+    run_on(quirks::Cosmac{}, screen, memory, {0x60, 0x00, 0xA4, 0x00, 0xD0, 0x00});
+
+    CHECK(lit_pixels(screen)==0u);
+  }
+
+  SECTION("Runs stop when the budget is exhausted") {
+    // V0 += 1, jump back
+    TestMachine machine{{0x70, 0x01, 0x12, 0x00}};
+    auto& processor = machine.processor;
+
+    auto const result = processor.run(100u);
+    CHECK(result.reason==StopReason::BudgetExhausted);
+    CHECK(result.cycles==100u);
+    CHECK(processor.cycles()==100u);
+
+    CHECK(processor.run_until(250u).cycles==150u);
+    CHECK(processor.run_until(200u).cycles==0u);
+  }
+
+  SECTION("Runs report the failing instruction") {
+    // V0 = 1, unsupported instruction
+    TestMachine machine{{0x60, 0x01, 0xE0, 0x00}};
+
+    auto const result = machine.processor.run(100u);
+    CHECK(result.reason==StopReason::UnsupportedInstruction);
+    CHECK(result.cycles==2u);
+    CHECK(result.pc==0x202_addr);
+    CHECK(result.opcode==0xE000u);
+  }
+
+  SECTION("Runs report stack underflows and overflows") {
+    // return without a call
+    TestMachine underflow{{0x00, 0xEE}};
+    CHECK(underflow.processor.run(10u).reason==StopReason::StackUnderflow);
+
+    // call itself forever
+    TestMachine overflow{{0x22, 0x00}};
+    auto const result = overflow.processor.run(100u);
+    CHECK(result.reason==StopReason::StackOverflow);
+    CHECK(result.cycles==CallStack::CAPACITY+1u);
+    CHECK(result.opcode==0x2200u);
+  }
+
+  SECTION("Runs stop at breakpoints and continue from them") {
+    // V0 += 1, V1 += 1, jump back
+    TestMachine machine{{0x70, 0x01, 0x71, 0x01, 0x12, 0x00}};
+    auto& processor = machine.processor;
+    processor.set_breakpoint(0x202_addr);
+
+    auto result = processor.run(100u);
+    CHECK(result.reason==StopReason::Breakpoint);
+    CHECK(result.cycles==1u);
+    CHECK(result.pc==0x202_addr);
+    CHECK(result.opcode==0x7101u);
+
+    result = processor.run(100u);
+    CHECK(result.reason==StopReason::Breakpoint);
+    CHECK(result.cycles==3u);
+
+    processor.clear_breakpoint(0x202_addr);
+    CHECK(processor.run(100u).reason==StopReason::BudgetExhausted);
+  }
+
+  SECTION("Runs stop at draws and waits for keys when asked to") {
+    // V0 = 0, draw, wait for key into V1
+    TestMachine machine{{0x60, 0x00, 0xD0, 0x01, 0xF1, 0x0A}};
+    auto& processor = machine.processor;
+
+    auto result = processor.run(100u, StopOn{.draw = true, .waiting_for_key = true});
+    CHECK(result.reason==StopReason::Draw);
+    CHECK(result.cycles==2u);
+    CHECK(result.pc==0x202_addr);
+
+    result = processor.run(100u, StopOn{.draw = true, .waiting_for_key = true});
+    CHECK(result.reason==StopReason::WaitingForKey);
+    CHECK(result.cycles==1u);
+    CHECK(result.opcode==0xF10Au);
+
+    CHECK(processor.run(100u).reason==StopReason::BudgetExhausted);
+  }
+
+  SECTION("Profiles selected at runtime dispatch to the matching quirks") {
+    auto const result = with_quirk_profile(QuirkProfile::Chip48, []<typename Quirks>(std::type_identity<Quirks>) {
+      return std::is_same_v<Quirks, quirks::Chip48>;
+    });
+    CHECK(result);
+  }
+}
@@ -0,0 +1,56 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <ring_buffer.hxx>
+
+#include <cstdint>
+#include <thread>
+
+using namespace chip8;
+
+TEST_CASE("RingBuffer", "[chip8][ring_buffer]")
+{
+  RingBuffer<int, 4u> ring{};
+
+  SECTION("Elements are returned in the order they were pushed") {
+    CHECK(ring.push(1));
+    CHECK(ring.push(2));
+    CHECK(*ring.front()==1);
+    CHECK(ring.pop()==1);
+    CHECK(ring.pop()==2);
+    CHECK(ring.empty());
+  }
+
+  SECTION("Pushing into a full ring fails") {
+    for (int n = 0; n<4; ++n)
+      CHECK(ring.push(n));
+    CHECK(!ring.push(4));
+    CHECK(ring.pop()==0);
+    CHECK(ring.push(4));
+  }
+
+  SECTION("Empty ring returns no elements") {
+    CHECK(ring.front()==nullptr);
+    CHECK(!ring.pop().has_value());
+  }
+
+  SECTION("Elements are transferred between threads") {
+    RingBuffer<std::uint32_t, 64u> shared{};
+    std::uint32_t constexpr count = 100'000u;
+
+    std::thread producer{[&shared] {
+      for (std::uint32_t n = 0; n<count;) {
+        if (shared.push(n))
+          ++n;
+      }
+    }};
+
+    std::uint32_t expected = 0u;
+    while (expected<count) {
+      if (auto const value = shared.pop(); value.has_value()) {
+        REQUIRE(*value==expected);
+        ++expected;
+      }
+    }
+    producer.join();
+  }
+}
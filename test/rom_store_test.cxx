@@ -0,0 +1,123 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_exception.hpp>
+
+#include <rom_store.hxx>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace Catch::Matchers;
+using namespace chip8;
+
+namespace {
+  void write_file(std::filesystem::path const& path, std::vector<std::uint8_t> const& content)
+  {
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<char const*>(content.data()), static_cast<std::streamsize>(content.size()));
+  }
+}
+
+TEST_CASE("RomStore", "[chip8][rom_store]")
+{
+  auto const directory = std::filesystem::temp_directory_path();
+  auto const path = directory/"chip8_rom_store_test.ch8";
+  auto const copy = directory/"chip8_rom_store_test_copy.ch8";
+  std::vector<std::uint8_t> const program{0x60, 0x01, 0x12, 0x02};
+  write_file(path, program);
+  RomStore store{};
+
+  SECTION("ROMs are mapped with their content") {
+    auto const rom = store.open(path);
+    REQUIRE(std::ranges::equal(rom->bytes(), program));
+    CHECK(rom->hash()==fnv1a64(program));
+    CHECK(rom->quirk_profile()==QuirkProfile::Cosmac);
+  }
+
+  SECTION("Opening a ROM again returns the same image") {
+    auto const rom = store.open(path);
+    REQUIRE(store.open(path)==rom);
+    REQUIRE(store.size()==1u);
+  }
+
+  SECTION("Files with the same content share an image") {
+    write_file(copy, program);
+    REQUIRE(store.open(copy)==store.open(path));
+    REQUIRE(store.size()==1u);
+  }
+
+  SECTION("Replaced files are mapped again") {
+    auto const rom = store.open(path);
+    write_file(copy, {0x60, 0x02, 0x12, 0x02, 0x00, 0xE0});
+    std::filesystem::rename(copy, path);
+    auto const changed = store.open(path);
+    REQUIRE(changed!=rom);
+    CHECK(changed->bytes().size()==6u);
+    // the old image stays valid for sessions still using it
+    CHECK(std::ranges::equal(rom->bytes(), program));
+  }
+
+  SECTION("Images of replaced files are dropped") {
+    store.open(path);
+    write_file(copy, {0x60, 0x02, 0x12, 0x02, 0x00, 0xE0});
+    std::filesystem::rename(copy, path);
+    store.open(path);
+    REQUIRE(store.size()==1u);
+  }
+
+  SECTION("Images stay while other files have them") {
+    write_file(copy, program);
+    auto const rom = store.open(path);
+    store.open(copy);
+    write_file(directory/"chip8_rom_store_test_new.ch8", {0x60, 0x02, 0x12, 0x02, 0x00, 0xE0});
+    std::filesystem::rename(directory/"chip8_rom_store_test_new.ch8", path);
+    store.open(path);
+    REQUIRE(store.size()==2u);
+    REQUIRE(store.open(copy)==rom);
+  }
+
+  SECTION("SUPER-CHIP ROMs are detected") {
+    write_file(path, {0x00, 0xFF, 0x12, 0x02});
+    REQUIRE(store.open(path)->quirk_profile()==QuirkProfile::SuperChip);
+  }
+
+  SECTION("SUPER-CHIP instructions are found behind calls") {
+    // call 0x204, loop; 0x204: high resolution, return
+    write_file(path, {0x22, 0x04, 0x12, 0x02, 0x00, 0xFF, 0x00, 0xEE});
+    REQUIRE(store.open(path)->quirk_profile()==QuirkProfile::SuperChip);
+  }
+
+  SECTION("Data looking like SUPER-CHIP instructions is ignored") {
+    // jump over a sprite row reading 0x00FF
+    write_file(path, {0x12, 0x04, 0x00, 0xFF, 0x12, 0x04});
+    REQUIRE(store.open(path)->quirk_profile()==QuirkProfile::Cosmac);
+  }
+
+  SECTION("The bundled ROMs are detected as COSMAC VIP programs") {
+    // the sprites of the IBM logo and Cave Explorer contain 0x00FF, 0x00FC, 0x00FB and 0x00FE
+    for (auto const* const name: {"15 Puzzle [Roger Ivie].ch8", "IBM Logo.ch8", "caveexplorer.ch8", "snek.ch8",
+        "test_opcode.ch8"}) {
+      INFO(name);
+      CHECK(store.open(std::filesystem::path{CHIP8_ASSETS_DIR}/name)->quirk_profile()==QuirkProfile::Cosmac);
+    }
+  }
+
+  SECTION("Missing files result in an exception") {
+    REQUIRE_THROWS_AS(store.open(directory/"chip8_rom_store_test_missing.ch8"), RomException);
+  }
+
+  SECTION("Empty files result in an exception") {
+    write_file(path, {});
+    REQUIRE_THROWS_MATCHES(store.open(path), RomException, Message("ROM " + path.string() + " is empty"));
+  }
+
+  SECTION("ROMs not fitting in memory result in an exception") {
+    write_file(path, std::vector<std::uint8_t>(Rom::MAX_SIZE+1u));
+    REQUIRE_THROWS_MATCHES(store.open(path), RomException,
+        Message("ROM " + path.string() + " does not fit in memory"));
+  }
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(copy);
+}
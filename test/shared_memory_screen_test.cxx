@@ -0,0 +1,75 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <shared_memory_screen.hxx>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace chip8;
+
+namespace {
+  struct KeyRecorder final {
+    std::vector<std::pair<std::uint8_t, bool>> keys{};
+
+    void toggle_key(std::uint8_t const index, bool const pressed)
+    {
+      keys.emplace_back(index, pressed);
+    }
+  };
+}
+
+TEST_CASE("SharedMemoryScreen", "[chip8][shared_memory_screen]")
+{
+  auto const name = "/chip8_test_"+std::to_string(getpid());
+  SharedMemoryScreen screen{name};
+  SharedFrameReader reader{name};
+
+  SECTION("Published frames can be read") {
+    CHECK(reader.read()->number==0u);
+
+    screen.set_pixel(0, 3, true);
+    CHECK(screen.publish());
+    auto const frame = reader.read();
+    REQUIRE(frame.has_value());
+    CHECK(frame->number==1u);
+    CHECK(frame->width==Screen::WIDTH);
+    CHECK(frame->rows[3][0]==0x8000'0000'0000'0000u);
+    CHECK(frame->pixel(0, 3));
+  }
+
+  SECTION("Published frames follow the resolution") {
+    screen.set_high_resolution(true);
+    screen.set_pixel(127, 63, true);
+    CHECK(screen.publish());
+    auto const frame = reader.read();
+    REQUIRE(frame.has_value());
+    CHECK(frame->width==Screen::HIRES_WIDTH);
+    CHECK(frame->height==Screen::HIRES_HEIGHT);
+    CHECK(frame->rows[63][1]==1u);
+  }
+
+  SECTION("Unchanged frames are not published again") {
+    screen.set_pixel(1, 1, true);
+    CHECK(screen.publish());
+    CHECK(!screen.publish());
+    CHECK(reader.read()->number==1u);
+  }
+
+  SECTION("Keys set by readers are forwarded to the processor") {
+    KeyRecorder processor{};
+    reader.set_key(0xA, true);
+    screen.forward_keys(processor);
+    reader.set_key(0xA, false);
+    reader.set_key(0x3, true);
+    screen.forward_keys(processor);
+    screen.forward_keys(processor);
+    CHECK(processor.keys==std::vector<std::pair<std::uint8_t, bool>>{{0xA, true}, {0x3, true}, {0xA, false}});
+  }
+
+  SECTION("Opening missing segments results in an exception") {
+    REQUIRE_THROWS_AS(SharedFrameReader{name+"_missing"}, SharedMemoryException);
+  }
+}
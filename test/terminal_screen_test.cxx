@@ -0,0 +1,101 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <terminal_screen.hxx>
+
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace chip8;
+
+namespace {
+  std::string drain(int const fd)
+  {
+    std::string result{};
+    char buffer[4096];
+    for (ssize_t count; (count = read(fd, buffer, sizeof(buffer)))>0;)
+      result.append(buffer, static_cast<std::size_t>(count));
+    return result;
+  }
+}
+
+TEST_CASE("TerminalScreen", "[chip8][terminal_screen]")
+{
+  int fds[2];
+  REQUIRE(pipe(fds)==0);
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+  {
+    TerminalScreen screen{fds[1]};
+
+    SECTION("Only changed cells are written") {
+      for (std::uint8_t x = 0; x<Screen::WIDTH; ++x)
+        screen.set_pixel(x, 0, true);
+      auto const full = screen.present();
+      CHECK(full==drain(fds[0]).size());
+
+      std::this_thread::sleep_for(TerminalScreen::REFRESH_INTERVAL);
+      screen.set_pixel(10, 0, false);
+      auto const partial = screen.present();
+      CHECK(partial>0u);
+      CHECK(partial<full/8u);
+      // cursor to row 1, column 11 followed by an empty cell
+      CHECK(drain(fds[0])=="\x1B[1;11H ");
+    }
+
+    SECTION("Output is capped at the refresh rate") {
+      screen.present();
+      screen.set_pixel(0, 0, true);
+      CHECK(screen.present()==0u);
+      std::this_thread::sleep_for(TerminalScreen::REFRESH_INTERVAL);
+      CHECK(screen.present()>0u);
+    }
+
+    SECTION("Frames are completed once a full terminal takes output again") {
+      int reference_fds[2];
+      REQUIRE(pipe(reference_fds)==0);
+      fcntl(reference_fds[0], F_SETFL, O_NONBLOCK);
+      std::string expected{};
+      {
+        TerminalScreen reference{reference_fds[1]};
+        for (std::uint8_t x = 0; x<Screen::WIDTH; ++x)
+          reference.set_pixel(x, 5, true);
+        reference.present();
+        expected = drain(reference_fds[0]);
+      }
+      close(reference_fds[0]);
+      close(reference_fds[1]);
+
+      // fill the pipe, so the terminal does not take any output
+      fcntl(fds[1], F_SETFL, O_NONBLOCK);
+      std::string const filler(4096u, 'x');
+      while (write(fds[1], filler.data(), filler.size())>0) {
+      }
+      while (write(fds[1], filler.data(), 1u)>0) {
+      }
+
+      for (std::uint8_t x = 0; x<Screen::WIDTH; ++x)
+        screen.set_pixel(x, 5, true);
+      CHECK(screen.present()==0u);
+
+      drain(fds[0]);
+      std::this_thread::sleep_for(TerminalScreen::REFRESH_INTERVAL);
+      CHECK(screen.present()==expected.size());
+      CHECK(drain(fds[0])==expected);
+
+      std::this_thread::sleep_for(TerminalScreen::REFRESH_INTERVAL);
+      CHECK(screen.present()==0u);
+    }
+
+    SECTION("Nothing is written if nothing changed") {
+      screen.present();
+      std::this_thread::sleep_for(TerminalScreen::REFRESH_INTERVAL);
+      CHECK(screen.present()==0u);
+    }
+  }
+
+  close(fds[0]);
+  close(fds[1]);
+}
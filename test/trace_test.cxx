@@ -0,0 +1,245 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_exception.hpp>
+
+#include <packed_screen.hxx>
+#include <processor.hxx>
+#include <trace.hxx>
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace Catch::Matchers;
+using namespace chip8;
+
+namespace {
+  std::vector<TraceRecord> make_records(std::size_t const count)
+  {
+    std::vector<TraceRecord> records(count);
+    auto pc = 0x200_addr;
+    for (std::size_t n = 0; n<count; ++n) {
+      auto& record = records[n];
+      record.pc = pc;
+      record.opcode = static_cast<std::uint16_t>(0x6000u+n);
+      record.v[n%16u] = static_cast<std::uint8_t>(n);
+      if (n>0u)
+        record.v[(n-1u)%16u] = records[n-1u].v[(n-1u)%16u];
+      record.i = Address{static_cast<std::uint16_t>(n*3u), Address::Truncate{}};
+      record.delay_timer = static_cast<std::uint8_t>(n/100u);
+      if (n%7u==0u) {
+        record.memory_address = record.i;
+        record.memory_length = 3u;
+        record.memory = {1u, 2u, static_cast<std::uint8_t>(n)};
+      }
+      pc = (n%5u==0u) ? Address{static_cast<std::uint16_t>(0x200u+n%0x100u)} : pc+2;
+    }
+    records.back().halted = true;
+    return records;
+  }
+
+  /**
+   * Record like a processor would, marking the registers that differ from the previous record as written.
+   *
+   * @param also_written Registers marked as written by every instruction even if they kept their value.
+   */
+  void write_records(TraceWriter& writer, std::vector<TraceRecord> const& records, std::uint16_t also_written = 0u)
+  {
+    std::array<std::uint8_t, 16u> previous{};
+    for (auto const& record: records) {
+      std::uint16_t written = 0u;
+      for (std::size_t n = 0; n<record.v.size(); ++n)
+        written |= record.v[n]!=previous[n] ? static_cast<std::uint16_t>(1u << n) : 0u;
+      previous = record.v;
+
+      writer.record(TraceStep{
+          .pc = record.pc,
+          .opcode = record.opcode,
+          .halted = record.halted,
+          .i = record.i,
+          .delay_timer = record.delay_timer,
+          .sound_timer = record.sound_timer,
+          .written_registers = static_cast<std::uint16_t>(written | also_written),
+          .v = record.v.data(),
+          .memory_address = record.memory_address,
+          .memory_length = record.memory_length,
+          .memory = record.memory.data(),
+      });
+    }
+  }
+
+  std::vector<std::uint8_t> read_rom(std::filesystem::path const& path)
+  {
+    std::ifstream file{path, std::ios::binary};
+    return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+  }
+}
+
+TEST_CASE("Trace", "[chip8][trace]")
+{
+  auto const path = std::filesystem::temp_directory_path()/"chip8_trace_test.c8t";
+
+  SECTION("Records can be written and read back") {
+    auto const records = make_records(100'000u);
+    {
+      TraceWriter writer{path};
+      write_records(writer, records);
+      REQUIRE_NOTHROW(writer.close());
+    }
+
+    // delta encoding has to keep the trace far smaller than the records themselves
+    CHECK(std::filesystem::file_size(path)<records.size()*sizeof(TraceRecord)/4u);
+
+    TraceReader reader{path};
+    for (auto const& record: records) {
+      auto const read = reader.next();
+      REQUIRE(read.has_value());
+      CHECK(*read==record);
+    }
+    CHECK(!reader.next().has_value());
+    CHECK(reader.position()==records.size());
+  }
+
+  SECTION("Processors record every executed instruction") {
+    // V0 = 156, V1 = 0xFF, I = 0x300, BCD of V0, store V0 and V1, jump to self
+    std::vector<std::uint8_t> const program{0x60, 0x9C, 0x61, 0xFF, 0xA3, 0x00, 0xF0, 0x33, 0xF1, 0x55, 0x12, 0x0A};
+    {
+      TraceWriter writer{path};
+      CallStack call_stack{};
+      Memory memory{};
+      PackedScreen screen{};
+      NullAudio audio{};
+      NullLogger logger{};
+      memory.load(Processor::CODE_START, program);
+      BasicProcessor<quirks::Cosmac> processor{quirks::Cosmac{}, call_stack, memory, screen, audio, logger};
+      processor.set_tracer(&writer);
+      for (int n = 0; n<7; ++n)
+        REQUIRE(processor.step());
+      processor.set_tracer(nullptr);
+      REQUIRE_NOTHROW(writer.close());
+    }
+
+    TraceReader reader{path};
+    std::vector<TraceRecord> records{};
+    while (auto const record = reader.next())
+      records.push_back(*record);
+    REQUIRE(records.size()==7u);
+
+    CHECK(records[0].pc==0x200_addr);
+    CHECK(records[0].opcode==0x609Cu);
+    CHECK(records[0].v[0]==0x9Cu);
+    CHECK(records[1].v[1]==0xFFu);
+    CHECK(records[1].v[0]==0x9Cu);
+    CHECK(records[2].i==0x300_addr);
+    CHECK(records[2].memory_length==0u);
+
+    CHECK(records[3].opcode==0xF033u);
+    CHECK(records[3].memory_address==0x300_addr);
+    REQUIRE(records[3].memory_length==3u);
+    CHECK(records[3].memory[0]==1u);
+    CHECK(records[3].memory[1]==5u);
+    CHECK(records[3].memory[2]==6u);
+
+    CHECK(records[4].opcode==0xF155u);
+    CHECK(records[4].memory_address==0x300_addr);
+    REQUIRE(records[4].memory_length==2u);
+    CHECK(records[4].memory[0]==0x9Cu);
+    CHECK(records[4].memory[1]==0xFFu);
+    // the COSMAC VIP increments I while storing
+    CHECK(records[4].i==0x302_addr);
+
+    CHECK(records[5].pc==0x20A_addr);
+    CHECK(records[6].pc==0x20A_addr);
+    CHECK(records[6].opcode==0x120Au);
+    CHECK(records[6].v[1]==0xFFu);
+    CHECK(!records[6].halted);
+  }
+
+  SECTION("Traces of the bundled ROMs match the processor state") {
+    for (auto const* const name: {"15 Puzzle [Roger Ivie].ch8", "IBM Logo.ch8", "caveexplorer.ch8", "snek.ch8",
+        "test_opcode.ch8"}) {
+      INFO(name);
+      // long enough to span several chunks, each of which starts over with all registers
+      std::vector<ProcessorState> states{};
+      {
+        TraceWriter writer{path};
+        CallStack call_stack{};
+        Memory memory{};
+        PackedScreen screen{};
+        NullAudio audio{};
+        NullLogger logger{};
+        memory.load(Processor::CODE_START, read_rom(std::filesystem::path{CHIP8_ASSETS_DIR}/name));
+        BasicProcessor<quirks::Cosmac> processor{quirks::Cosmac{}, call_stack, memory, screen, audio, logger};
+        processor.seed(1u);
+        processor.set_tracer(&writer);
+        for (std::uint64_t n = 1; n<=100'000u; ++n) {
+          auto const running = processor.step();
+          states.push_back(processor.state());
+          if (!running)
+            break;
+          if (n%CYCLES_PER_TIMER_TICK==0u)
+            processor.update_timers();
+        }
+        processor.set_tracer(nullptr);
+        REQUIRE_NOTHROW(writer.close());
+      }
+
+      TraceReader reader{path};
+      std::size_t mismatches = 0u;
+      for (auto const& state: states) {
+        auto const record = reader.next();
+        REQUIRE(record.has_value());
+        if (record->v!=state.v || record->i!=state.i || record->delay_timer!=state.delay_timer
+            || record->sound_timer!=state.sound_timer)
+          ++mismatches;
+      }
+      CHECK(mismatches==0u);
+      CHECK(!reader.next().has_value());
+    }
+  }
+
+  SECTION("Registers written with their old value are not stored again") {
+    auto const records = make_records(10'000u);
+    {
+      TraceWriter writer{path};
+      write_records(writer, records);
+      writer.close();
+    }
+    auto const size = std::filesystem::file_size(path);
+    {
+      TraceWriter writer{path};
+      write_records(writer, records, 0xFFFFu);
+      writer.close();
+    }
+    CHECK(std::filesystem::file_size(path)==size);
+
+    TraceReader reader{path};
+    for (auto const& record: records) {
+      auto const read = reader.next();
+      REQUIRE(read.has_value());
+      CHECK(*read==record);
+    }
+  }
+
+  SECTION("Records after closing are dropped") {
+    TraceWriter writer{path};
+    writer.close();
+    write_records(writer, make_records(1u));
+    TraceReader reader{path};
+    CHECK(!reader.next().has_value());
+  }
+
+  SECTION("Empty traces contain no records") {
+    TraceWriter{path}.close();
+    TraceReader reader{path};
+    CHECK(!reader.next().has_value());
+  }
+
+  SECTION("Reading other files results in an exception") {
+    std::ofstream{path} << "not a trace";
+    REQUIRE_THROWS_MATCHES(TraceReader{path}, TraceException, Message("Not a trace file"));
+  }
+
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,320 @@
+#include <frame_capture.hxx>
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+  std::array<std::uint8_t, 8u> constexpr PNG_SIGNATURE{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  std::size_t constexpr MAX_STORED_BLOCK = 0xFFFFu;
+
+  std::array<std::uint32_t, 256u> constexpr CRC_TABLE = [] {
+    std::array<std::uint32_t, 256u> table{};
+    for (std::uint32_t n = 0; n<table.size(); ++n) {
+      auto c = n;
+      for (int k = 0; k<8; ++k)
+        c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+    return table;
+  }();
+
+  void put_u16(std::vector<std::uint8_t>& out, std::uint16_t const value)
+  {
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+    out.push_back(static_cast<std::uint8_t>(value));
+  }
+
+  void put_u32(std::vector<std::uint8_t>& out, std::uint32_t const value)
+  {
+    for (int n = 3; n>=0; --n)
+      out.push_back(static_cast<std::uint8_t>(value >> (8*n)));
+  }
+
+  /**
+   * The image the frames are drawn onto, which has the high resolution if any frame of the capture has it.
+   */
+  struct Canvas final {
+    bool high_resolution;
+    std::uint32_t scale;
+
+    [[nodiscard]] std::uint32_t width() const noexcept
+    {
+      return (high_resolution ? chip8::Screen::HIRES_WIDTH : chip8::Screen::WIDTH)*scale;
+    }
+
+    [[nodiscard]] std::uint32_t height() const noexcept
+    {
+      return (high_resolution ? chip8::Screen::HIRES_HEIGHT : chip8::Screen::HEIGHT)*scale;
+    }
+
+    [[nodiscard]] bool pixel(chip8::FrameBuffer const& frame, std::uint32_t const x,
+        std::uint32_t const y) const noexcept
+    {
+      // frames in the low resolution fill the canvas with pixels twice the size
+      auto const factor = high_resolution && !frame.high_resolution ? 2u*scale : scale;
+      return frame.pixel(static_cast<std::uint8_t>(x/factor), static_cast<std::uint8_t>(y/factor));
+    }
+  };
+
+  Canvas make_canvas(chip8::FrameCaptureReader& reader, std::uint32_t const scale)
+  {
+    Canvas canvas{.high_resolution = false, .scale = scale};
+    if (reader.frame_count()==0u)
+      return canvas;
+
+    reader.seek(0u);
+    while (auto const frame = reader.next())
+      canvas.high_resolution = canvas.high_resolution || frame->high_resolution;
+    reader.seek(0u);
+    return canvas;
+  }
+
+  /**
+   * Writes the frames as an animated PNG with 1 bit per pixel.
+   *
+   * The image data is wrapped into stored deflate blocks, so no compression library is needed.
+   * Consecutive identical frames are merged into one frame with a longer delay.
+   */
+  class ApngWriter final {
+  public:
+    /**
+     * Write the header of the image.
+     *
+     * @throws chip8::CaptureException if there are no frames, which no valid image can be written for.
+     */
+    ApngWriter(std::ofstream& out, Canvas const& canvas, std::uint32_t const frames, std::uint8_t const frame_rate)
+        :out_{out}, canvas_{canvas}, frame_rate_{frame_rate}
+    {
+      if (frames==0u)
+        throw chip8::CaptureException{"The capture does not contain any frames"};
+
+      out_.write(reinterpret_cast<char const*>(PNG_SIGNATURE.data()), PNG_SIGNATURE.size());
+
+      std::vector<std::uint8_t> data{};
+      put_u32(data, width());
+      put_u32(data, height());
+      // bit depth 1, grayscale, deflate, adaptive filtering, no interlacing
+      data.insert(data.end(), {1u, 0u, 0u, 0u, 0u});
+      chunk("IHDR", data);
+
+      data.clear();
+      put_u32(data, frames);
+      put_u32(data, 0u);
+      chunk("acTL", data);
+    }
+
+    void frame(chip8::FrameBuffer const& frame, std::uint16_t const duration)
+    {
+      std::vector<std::uint8_t> data{};
+      put_u32(data, sequence_++);
+      put_u32(data, width());
+      put_u32(data, height());
+      put_u32(data, 0u);
+      put_u32(data, 0u);
+      put_u16(data, duration);
+      put_u16(data, frame_rate_);
+      // no disposal, no blending, every frame covers the whole image
+      data.insert(data.end(), {0u, 0u});
+      chunk("fcTL", data);
+
+      data.clear();
+      if (!first_)
+        put_u32(data, sequence_++);
+      zlib_stored(image(frame), data);
+      chunk(first_ ? "IDAT" : "fdAT", data);
+      first_ = false;
+    }
+
+    void finish()
+    {
+      chunk("IEND", {});
+    }
+
+  private:
+    std::ofstream& out_;
+    Canvas canvas_;
+    std::uint8_t frame_rate_;
+    std::uint32_t sequence_{0u};
+    bool first_{true};
+
+    [[nodiscard]] std::uint32_t width() const noexcept
+    {
+      return canvas_.width();
+    }
+
+    [[nodiscard]] std::uint32_t height() const noexcept
+    {
+      return canvas_.height();
+    }
+
+    [[nodiscard]] std::vector<std::uint8_t> image(chip8::FrameBuffer const& frame) const
+    {
+      auto const row_size = width()/8u;
+      std::vector<std::uint8_t> data((1u+row_size)*height());
+      for (std::uint32_t y = 0; y<height(); ++y) {
+        // every row starts with the filter type, 0 being none
+        auto* const row = data.data()+y*(1u+row_size)+1u;
+        for (std::uint32_t x = 0; x<width(); ++x) {
+          if (canvas_.pixel(frame, x, y))
+            row[x/8u] |= static_cast<std::uint8_t>(0x80u >> (x%8u));
+        }
+      }
+      return data;
+    }
+
+    static void zlib_stored(std::vector<std::uint8_t> const& data, std::vector<std::uint8_t>& out)
+    {
+      // deflate with a 32 KiB window, no preset dictionary, fastest compression
+      out.insert(out.end(), {0x78u, 0x01u});
+      std::size_t offset = 0u;
+      do {
+        auto const length = std::min(MAX_STORED_BLOCK, data.size()-offset);
+        auto const last = offset+length==data.size();
+        out.push_back(last ? 1u : 0u);
+        out.push_back(static_cast<std::uint8_t>(length));
+        out.push_back(static_cast<std::uint8_t>(length >> 8));
+        out.push_back(static_cast<std::uint8_t>(~length));
+        out.push_back(static_cast<std::uint8_t>(~length >> 8));
+        out.insert(out.end(), data.begin()+static_cast<std::ptrdiff_t>(offset),
+            data.begin()+static_cast<std::ptrdiff_t>(offset+length));
+        offset += length;
+      }
+      while (offset<data.size());
+
+      std::uint32_t a = 1u;
+      std::uint32_t b = 0u;
+      for (auto const byte: data) {
+        a = (a+byte)%65521u;
+        b = (b+a)%65521u;
+      }
+      put_u32(out, (b << 16) | a);
+    }
+
+    void chunk(char const (& type)[5], std::vector<std::uint8_t> const& data)
+    {
+      std::vector<std::uint8_t> header{};
+      put_u32(header, static_cast<std::uint32_t>(data.size()));
+      header.insert(header.end(), type, type+4);
+
+      auto crc = 0xFFFFFFFFu;
+      auto const update = [&crc](std::uint8_t const byte) { crc = CRC_TABLE[(crc ^ byte) & 0xFFu] ^ (crc >> 8); };
+      std::for_each(header.begin()+4, header.end(), update);
+      std::for_each(data.begin(), data.end(), update);
+
+      std::vector<std::uint8_t> trailer{};
+      put_u32(trailer, crc ^ 0xFFFFFFFFu);
+
+      out_.write(reinterpret_cast<char const*>(header.data()), static_cast<std::streamsize>(header.size()));
+      out_.write(reinterpret_cast<char const*>(data.data()), static_cast<std::streamsize>(data.size()));
+      out_.write(reinterpret_cast<char const*>(trailer.data()), static_cast<std::streamsize>(trailer.size()));
+    }
+  };
+
+  /**
+   * Call the callback for every run of identical frames, split into runs of at most 0xFFFF frames.
+   */
+  template<typename Callback>
+  void for_each_run(chip8::FrameCaptureReader& reader, Callback&& callback)
+  {
+    reader.seek(0u);
+    auto current = reader.next();
+    std::uint16_t duration = 1u;
+    while (current.has_value()) {
+      auto const frame = reader.next();
+      if (frame==current && duration<0xFFFFu) {
+        ++duration;
+        continue;
+      }
+      callback(*current, duration);
+      current = frame;
+      duration = 1u;
+    }
+  }
+
+  void write_apng(chip8::FrameCaptureReader& reader, std::ofstream& out, Canvas const& canvas)
+  {
+    std::uint32_t runs = 0u;
+    for_each_run(reader, [&runs](auto const&, auto) { ++runs; });
+
+    ApngWriter writer{out, canvas, runs, reader.frame_rate()};
+    for_each_run(reader, [&writer](auto const& frame, auto const duration) { writer.frame(frame, duration); });
+    writer.finish();
+  }
+
+  void write_rgb(chip8::FrameCaptureReader& reader, std::ofstream& out, Canvas const& canvas)
+  {
+    std::vector<char> image(static_cast<std::size_t>(canvas.width())*canvas.height()*3u);
+    while (auto const frame = reader.next()) {
+      auto* pixels = image.data();
+      for (std::uint32_t y = 0; y<canvas.height(); ++y) {
+        for (std::uint32_t x = 0; x<canvas.width(); ++x) {
+          auto const value = canvas.pixel(*frame, x, y) ? '\xFF' : '\x00';
+          *pixels++ = value;
+          *pixels++ = value;
+          *pixels++ = value;
+        }
+      }
+      out.write(image.data(), static_cast<std::streamsize>(image.size()));
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  std::vector<std::string_view> positional{};
+  std::uint32_t scale = 1u;
+  for (int n = 1; n<argc; ++n) {
+    std::string_view const arg{argv[n]};
+    if (arg.starts_with("--scale="))
+      scale = static_cast<std::uint32_t>(std::stoul(std::string{arg.substr(8)}));
+    else
+      positional.push_back(arg);
+  }
+
+  if (positional.size()!=2u || scale==0u || scale>32u) {
+    std::cerr << "Usage: ./chip8_capture_convert [capture] [output.png|output.rgb] {--scale=1..32}\n";
+    return 2;
+  }
+
+  try {
+    chip8::FrameCaptureReader reader{positional[0]};
+    auto const rgb = positional[1].ends_with(".rgb");
+    // raw video may be empty, an animated PNG needs a frame, so the output is not even created without one
+    if (!rgb && reader.frame_count()==0u) {
+      std::cerr << "The capture does not contain any frames\n";
+      return 1;
+    }
+
+    std::ofstream out{std::string{positional[1]}, std::ios::binary | std::ios::trunc};
+    if (!out) {
+      std::cerr << "Could not create " << positional[1] << '\n';
+      return 2;
+    }
+
+    auto const canvas = make_canvas(reader, scale);
+    if (rgb) {
+      write_rgb(reader, out, canvas);
+      std::cerr << reader.frame_count() << " frames of " << canvas.width() << 'x' << canvas.height()
+                << " rgb24 at " << static_cast<int>(reader.frame_rate()) << " fps\n";
+    }
+    else {
+      write_apng(reader, out, canvas);
+    }
+
+    out.close();
+    if (out.fail()) {
+      std::cerr << "Could not write " << positional[1] << '\n';
+      return 1;
+    }
+  }
+  catch (chip8::CaptureException const& ex) {
+    std::cerr << ex.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
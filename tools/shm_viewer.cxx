@@ -0,0 +1,49 @@
+#include <shared_frame.hxx>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+/**
+ * Example consumer of the frames exported by chip_8_headless --screen=shm:name.
+ *
+ * Prints every new frame as text. Keys given on the command line are held down while the viewer runs.
+ */
+int main(int argc, char** argv)
+{
+  if (argc<2) {
+    std::fprintf(stderr, "Usage: ./chip8_shm_viewer [name] {key...}\n");
+    return 2;
+  }
+
+  try {
+    chip8::SharedFrameReader reader{argv[1]};
+    for (int n = 2; n<argc; ++n)
+      reader.set_key(static_cast<std::uint8_t>(std::strtoul(argv[n], nullptr, 16)), true);
+
+    std::uint64_t shown = 0u;
+    while (true) {
+      if (auto const frame = reader.read(); frame.has_value() && frame->number!=shown) {
+        shown = frame->number;
+
+        std::string text = "\x1B[H";
+        text += "frame " + std::to_string(frame->number) + '\n';
+        for (std::uint16_t y = 0; y<frame->height; ++y) {
+          for (std::uint16_t x = 0; x<frame->width; ++x)
+            text += frame->pixel(x, y) ? '#' : '.';
+          text += "\x1B[K\n";
+        }
+        text += "\x1B[J";
+        std::fputs(text.c_str(), stdout);
+        std::fflush(stdout);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds{16});
+    }
+  }
+  catch (chip8::SharedMemoryException const& ex) {
+    std::fprintf(stderr, "%s\n", ex.what());
+    return 1;
+  }
+}
@@ -0,0 +1,68 @@
+#include <trace.hxx>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+
+namespace {
+  void print_record(std::ostream& out, char const* name, std::optional<chip8::TraceRecord> const& record)
+  {
+    out << name << ": ";
+    if (!record.has_value()) {
+      out << "<end of trace>\n";
+      return;
+    }
+
+    out << std::hex << std::setfill('0')
+        << "PC=0x" << std::setw(3) << static_cast<std::uint16_t>(record->pc)
+        << " opcode=0x" << std::setw(4) << record->opcode
+        << " I=0x" << std::setw(3) << static_cast<std::uint16_t>(record->i)
+        << " DT=0x" << std::setw(2) << static_cast<int>(record->delay_timer)
+        << " ST=0x" << std::setw(2) << static_cast<int>(record->sound_timer);
+    for (std::size_t n = 0; n<record->v.size(); ++n)
+      out << " V" << n << "=0x" << std::setw(2) << static_cast<int>(record->v[n]);
+    if (record->memory_length>0u) {
+      out << " [0x" << std::setw(3) << static_cast<std::uint16_t>(record->memory_address) << "]=";
+      for (std::uint8_t n = 0; n<record->memory_length; ++n)
+        out << std::setw(2) << static_cast<int>(record->memory[n]);
+    }
+    if (record->halted)
+      out << " halted";
+    out << std::dec << '\n';
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if (argc!=3) {
+    std::cerr << "Usage: ./chip8_trace_diff [trace] [trace]\n";
+    return 2;
+  }
+
+  try {
+    chip8::TraceReader left{argv[1]};
+    chip8::TraceReader right{argv[2]};
+
+    while (true) {
+      auto const a = left.next();
+      auto const b = right.next();
+      if (!a.has_value() && !b.has_value()) {
+        std::cout << "Traces are identical (" << left.position() << " instructions)\n";
+        return 0;
+      }
+
+      if (a!=b) {
+        auto const index = std::max(left.position(), right.position())-1u;
+        std::cout << "Traces diverge at instruction " << index << '\n';
+        print_record(std::cout, argv[1], a);
+        print_record(std::cout, argv[2], b);
+        return 1;
+      }
+    }
+  }
+  catch (chip8::TraceException const& ex) {
+    std::cerr << ex.what() << '\n';
+    return 2;
+  }
+}
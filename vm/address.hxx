@@ -9,8 +9,8 @@
 
 namespace chip8 {
   /**
-   * Exception class being thrown when trying to construct an Address from
-   * a value that does not fit in 12 bits.
+   * Exception class being thrown when trying to construct an address from
+   * a value that does not fit in its number of bits.
    *
    * Even though the class has the same functionality as its base,
    * it exists for improved readability as it is more specific.
@@ -21,59 +21,64 @@ namespace chip8 {
   };
 
   /**
-   * Class representing an address in CHIP-8's memory.
+   * Class representing an address in the memory of a CHIP-8 variant.
    *
-   * CHIP-8 only supports 12 bit addresses, which is fine, as the memory is also fixed to 4kiB,
-   * which is fully addressable by 12 bits.
+   * All arithmetic wraps around at the end of the address space, just like the memory does.
+   *
+   * @tparam Bits The width of the address space. CHIP-8 uses 12 bits for its 4kiB of memory, XO-CHIP 16 bits.
    */
-  class Address final {
+  template<std::uint8_t Bits>
+  class BasicAddress final {
+    static_assert(Bits==12u || Bits==16u, "Only the address spaces of CHIP-8 and XO-CHIP are supported");
+
   public:
-    static std::uint16_t constexpr VALUE_MASK = 0x0FFF;
+    static std::uint16_t constexpr VALUE_MASK = static_cast<std::uint16_t>((1u << Bits)-1u);
 
     /**
-     * Marker class to construct an address from arbitrary values by truncating them to 12 bits.
+     * Marker class to construct an address from arbitrary values by truncating them to the address space.
      */
     struct Truncate final {
     };
 
     /**
      * Construct an address from a raw value.
-     * @param value The raw address. Must fit in 12 bits.
+     * @param value The raw address. Must fit in the address space.
      * @throws InvalidAddressException if the address is too big.
      */
-    constexpr explicit Address(std::uint16_t const value = 0U)
+    constexpr explicit BasicAddress(std::uint16_t const value = 0U)
         :value_{value}
     {
       if ((value_ & (~VALUE_MASK))!=0U) {
         // this exception is used to force a compilation error when constructing an Address
         // using the user-defined literal with a value that does not fit in 12 bits
-        throw InvalidAddressException{"Provided address does not fit in 12 bits."};
+        throw InvalidAddressException{Bits==12u ? "Provided address does not fit in 12 bits."
+                                                : "Provided address does not fit in 16 bits."};
       }
     }
 
     /**
-     * Construct an address from a raw value by truncating it to 12 bits.
-     * @param value The raw address. Will be truncated to 12 bits.
+     * Construct an address from a raw value by truncating it to the address space.
+     * @param value The raw address. Will be truncated to the address space.
      */
-    constexpr Address(std::uint16_t const value, Truncate const) noexcept
+    constexpr BasicAddress(std::uint16_t const value, Truncate const) noexcept
         :value_{static_cast<std::uint16_t>(value & VALUE_MASK)}
     {
     }
 
-    constexpr Address(Address const&) noexcept = default;
+    constexpr BasicAddress(BasicAddress const&) noexcept = default;
 
-    ~Address() noexcept = default;
+    ~BasicAddress() noexcept = default;
 
-    constexpr Address& operator=(Address const&) noexcept = default;
+    constexpr BasicAddress& operator=(BasicAddress const&) noexcept = default;
 
-    constexpr std::strong_ordering operator<=>(Address const& rhs) const noexcept = default;
+    constexpr std::strong_ordering operator<=>(BasicAddress const& rhs) const noexcept = default;
 
-    constexpr Address operator+(int const offset) const noexcept
+    constexpr BasicAddress operator+(int const offset) const noexcept
     {
-      return Address{static_cast<std::uint16_t>(value_+offset), Address::Truncate{}};
+      return BasicAddress{static_cast<std::uint16_t>(value_+offset), Truncate{}};
     }
 
-    constexpr Address& operator+=(int const offset) noexcept
+    constexpr BasicAddress& operator+=(int const offset) noexcept
     {
       return (*this) = (*this)+offset;
     }
@@ -81,7 +86,7 @@ namespace chip8 {
     /**
      * Overload of prefix increment operator.
      */
-    constexpr Address& operator++() noexcept
+    constexpr BasicAddress& operator++() noexcept
     {
       value_ = (value_+1) & VALUE_MASK;
       return *this;
@@ -90,7 +95,7 @@ namespace chip8 {
     /**
      * Overload of prefix decrement operator.
      */
-    constexpr Address& operator--() noexcept
+    constexpr BasicAddress& operator--() noexcept
     {
       value_ = (value_-1) & VALUE_MASK;
       return *this;
@@ -99,9 +104,9 @@ namespace chip8 {
     /**
      * Overload of postfix increment operator.
      */
-    constexpr Address operator++(int)& noexcept // NOLINT(*-dcl21-cpp)
+    constexpr BasicAddress operator++(int)& noexcept // NOLINT(*-dcl21-cpp)
     {
-      Address result{*this};
+      BasicAddress result{*this};
       ++(*this);
       return result;
     }
@@ -109,9 +114,9 @@ namespace chip8 {
     /**
      * Overload of postfix decrement operator.
      */
-    constexpr Address operator--(int)& noexcept // NOLINT(*-dcl21-cpp)
+    constexpr BasicAddress operator--(int)& noexcept // NOLINT(*-dcl21-cpp)
     {
-      Address result{*this};
+      BasicAddress result{*this};
       --(*this);
       return result;
     }
@@ -129,6 +134,16 @@ namespace chip8 {
     std::uint16_t value_;
   };
 
+  /**
+   * Address in the 4kiB memory of CHIP-8 and SUPER-CHIP.
+   */
+  using Address = BasicAddress<12u>;
+
+  /**
+   * Address in the 64kiB memory of XO-CHIP.
+   */
+  using LongAddress = BasicAddress<16u>;
+
   consteval Address operator "" _addr(unsigned long long value)
   {
     // this makes sure that values greater than 0x0FFF
@@ -0,0 +1,38 @@
+#pragma once
+
+#ifndef CHIP8_VM_AUDIO_HXX
+#define CHIP8_VM_AUDIO_HXX
+
+#include <cstdint>
+
+namespace chip8 {
+  /**
+   * Interface representing the sound output.
+   *
+   * This needs to be implemented by specific frontends.
+   */
+  struct Audio {
+    virtual ~Audio() noexcept = default;
+
+    /**
+     * Turn the beeper on or off.
+     *
+     * Called from the thread running the processor whenever the sound timer starts or stops.
+     *
+     * @param on true, if the beeper should sound, false otherwise.
+     * @param cycle The processor cycle at which the beeper changed.
+     */
+    virtual void beeper(bool on, std::uint64_t cycle) = 0;
+  };
+
+  /**
+   * Audio output discarding everything, for headless runs.
+   */
+  struct NullAudio final : Audio {
+    void beeper(bool, std::uint64_t) override
+    {
+    }
+  };
+}
+
+#endif // CHIP8_VM_AUDIO_HXX
@@ -0,0 +1,80 @@
+#include "beeper.hxx"
+
+namespace chip8 {
+  Beeper::Beeper(std::uint64_t const cycles_per_second) noexcept
+      :cycles_per_second_{cycles_per_second>0u ? cycles_per_second : 1u}
+  {
+  }
+
+  void Beeper::set_output_format(std::uint32_t const sample_rate, std::uint32_t const buffer_size) noexcept
+  {
+    sample_rate_ = sample_rate;
+    buffer_size_ = buffer_size;
+  }
+
+  void Beeper::beeper(bool const on, std::uint64_t const cycle)
+  {
+    // the ring holds far more transitions than the sound timer can produce per buffer,
+    // so a full ring means the audio device is not running and the event can be dropped
+    events_.push(Event{cycle, on ? Change::On : Change::Off, 0u});
+  }
+
+  void Beeper::set_speed(unsigned const multiplier, std::uint64_t const cycle) noexcept
+  {
+    events_.push(Event{cycle, Change::Speed, multiplier});
+  }
+
+  void Beeper::render(std::span<std::int16_t> const samples) noexcept
+  {
+    auto const buffer = static_cast<std::int64_t>(buffer_size_);
+    for (std::size_t n = 0; n<samples.size(); ++n) {
+      auto const now = static_cast<std::int64_t>(rendered_+n);
+
+      while (auto const event = events_.front()) {
+        // without a speed there is no clock to place events by
+        auto at = now;
+        if (speed_>0u) {
+          at = sample_of(event->cycle)+offset_;
+          // resynchronise on the first event and whenever emulation and audio clock drifted apart
+          if (!synced_ || at<now-buffer || at>now+2*buffer) {
+            offset_ = now+buffer-sample_of(event->cycle);
+            at = now+buffer;
+            synced_ = true;
+          }
+          if (at>now)
+            break;
+        }
+
+        if (event->change==Change::Speed) {
+          speed_sample_ = speed_>0u ? sample_of(event->cycle) : 0;
+          synced_ = synced_ && speed_>0u;
+          speed_cycle_ = event->cycle;
+          speed_ = event->speed;
+        }
+        else {
+          on_ = event->change==Change::On;
+        }
+        events_.pop();
+      }
+
+      phase_ += TONE_FREQUENCY;
+      if (phase_>=sample_rate_)
+        phase_ -= sample_rate_;
+
+      if (!on_)
+        samples[n] = 0;
+      else
+        samples[n] = phase_<sample_rate_/2u ? AMPLITUDE : static_cast<std::int16_t>(-AMPLITUDE);
+    }
+    rendered_ += samples.size();
+  }
+
+  std::int64_t Beeper::sample_of(std::uint64_t const cycle) const noexcept
+  {
+    auto const elapsed = cycle-speed_cycle_;
+    auto const cycles_per_second = cycles_per_second_*speed_;
+    auto const seconds = elapsed/cycles_per_second;
+    auto const rest = elapsed%cycles_per_second;
+    return speed_sample_+static_cast<std::int64_t>(seconds*sample_rate_+rest*sample_rate_/cycles_per_second);
+  }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#ifndef CHIP8_VM_BEEPER_HXX
+#define CHIP8_VM_BEEPER_HXX
+
+#include <cstdint>
+#include <span>
+
+#include "audio.hxx"
+#include "ring_buffer.hxx"
+
+namespace chip8 {
+  /**
+   * Audio output synthesising the beeper as a square wave.
+   *
+   * The processor thread queues timestamped on/off events through a lock-free ring,
+   * the audio thread turns them into samples at the exact position given by their cycle.
+   * Events are played back with a fixed delay of one buffer, which is what it takes to place them sample accurately.
+   * Speed changes are queued the same way, so cycles are always converted at the speed they were executed at.
+   */
+  class Beeper final : public Audio {
+  public:
+    static std::size_t constexpr EVENT_CAPACITY = 256u;
+    static std::uint32_t constexpr TONE_FREQUENCY = 440u;
+    static std::int16_t constexpr AMPLITUDE = 4096;
+
+    /**
+     * Construct a beeper.
+     *
+     * @param cycles_per_second The number of instructions the processor executes per second at normal speed.
+     */
+    explicit Beeper(std::uint64_t cycles_per_second) noexcept;
+
+    Beeper(Beeper const&) = delete;
+
+    Beeper& operator=(Beeper const&) = delete;
+
+    /**
+     * Set the format of the audio device. Must be called before the first call to render().
+     *
+     * @param sample_rate The number of samples per second.
+     * @param buffer_size The number of samples the device requests at once.
+     */
+    void set_output_format(std::uint32_t sample_rate, std::uint32_t buffer_size) noexcept;
+
+    void beeper(bool on, std::uint64_t cycle) override;
+
+    /**
+     * Change the speed of the processor, which runs at normal speed until the first call.
+     *
+     * Called from the processor thread. While the processor runs as fast as possible,
+     * events are played as soon as the audio thread sees them.
+     *
+     * @param multiplier The speed relative to the normal speed, 0 if the processor runs as fast as possible.
+     * @param cycle The cycle from which on the processor runs at the new speed.
+     */
+    void set_speed(unsigned multiplier, std::uint64_t cycle) noexcept;
+
+    /**
+     * Fill a buffer with mono samples.
+     *
+     * Called from the audio thread. Never blocks and never allocates.
+     *
+     * @param samples The buffer to fill.
+     */
+    void render(std::span<std::int16_t> samples) noexcept;
+
+  private:
+    enum class Change : std::uint8_t {
+      Off,
+      On,
+      Speed,
+    };
+
+    struct Event final {
+      std::uint64_t cycle;
+      Change change;
+      unsigned speed;
+    };
+
+    std::uint64_t cycles_per_second_;
+    std::uint32_t sample_rate_{48'000u};
+    std::uint32_t buffer_size_{128u};
+    RingBuffer<Event, EVENT_CAPACITY> events_{};
+
+    // only touched by the audio thread
+    std::uint64_t rendered_{0u};
+    std::int64_t offset_{0};
+    bool synced_{false};
+    bool on_{false};
+    std::uint32_t phase_{0u};
+    unsigned speed_{1u};
+    // the cycle from which on the current speed applies and its sample, before the offset
+    std::uint64_t speed_cycle_{0u};
+    std::int64_t speed_sample_{0};
+
+    [[nodiscard]] std::int64_t sample_of(std::uint64_t cycle) const noexcept;
+  };
+}
+
+#endif // CHIP8_VM_BEEPER_HXX
@@ -1,35 +1,37 @@
 #include "call_stack.hxx"
 
 namespace chip8 {
-  void CallStack::push(Address const address)
+  bool CallStack::push(Address const address)
   {
-    stack_.push(address);
+    if (size_==CAPACITY)
+      return false;
+
+    stack_[size_++] = address;
+    return true;
   }
 
   std::optional<Address> CallStack::pop()
   {
-    if (stack_.empty()) {
+    if (size_==0u) {
       return {};
     }
     else {
-      auto const result = stack_.top();
-      stack_.pop();
-      return result;
+      return stack_[--size_];
     }
   }
 
   std::optional<Address> CallStack::top() const
   {
-    return stack_.empty() ? std::optional<Address>{} : std::optional<Address>{stack_.top()};
+    return size_==0u ? std::optional<Address>{} : std::optional<Address>{stack_[size_-1u]};
   }
 
   std::size_t CallStack::size() const
   {
-    return stack_.size();
+    return size_;
   }
 
   bool CallStack::empty() const
   {
-    return stack_.empty();
+    return size_==0u;
   }
 }
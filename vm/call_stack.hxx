@@ -3,20 +3,27 @@
 #ifndef CHIP8_VM_CALLSTACK_HXX
 #define CHIP8_VM_CALLSTACK_HXX
 
+#include <array>
+#include <cstddef>
 #include <optional>
-#include <stack>
 
 #include "address.hxx"
 
 namespace chip8 {
+  /**
+   * The return addresses of subroutine calls, limited to the 16 levels SUPER-CHIP offers.
+   */
   class CallStack final {
   public:
+    static std::size_t constexpr CAPACITY = 16u;
+
     /**
      * Push an address onto the call stack.
      *
      * @param address The address to be pushed.
+     * @return true, if the address was pushed, false if the stack is full.
      */
-    void push(Address address);
+    [[nodiscard]] bool push(Address address);
 
     /**
      * Pop the most recently pushed address from the stack and return it.
@@ -47,7 +54,8 @@ namespace chip8 {
     [[nodiscard]] bool empty() const;
 
   private:
-    std::stack<Address> stack_{};
+    std::array<Address, CAPACITY> stack_;
+    std::size_t size_{0u};
   };
 }
 
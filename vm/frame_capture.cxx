@@ -0,0 +1,393 @@
+#include "frame_capture.hxx"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+namespace chip8 {
+  namespace {
+    std::array<char, 4u> constexpr FILE_MAGIC{'C', '8', 'F', 'C'};
+    std::array<char, 4u> constexpr INDEX_MAGIC{'C', '8', 'F', 'I'};
+    std::uint8_t constexpr VERSION = 2u;
+    std::size_t constexpr HEADER_SIZE = 8u;
+    std::size_t constexpr FOOTER_SIZE = 24u;
+    std::size_t constexpr MAX_FRAME_SIZE = Screen::HIRES_WIDTH/8u*Screen::HIRES_HEIGHT;
+
+    enum RecordType : std::uint8_t {
+      KEYFRAME = 0x00,
+      DELTA = 0x01,
+      /**
+       * Flag of keyframes in the high resolution. Deltas always have the resolution of their predecessor.
+       */
+      HIGH_RESOLUTION = 0x80,
+    };
+
+    using FrameBytes = std::array<std::uint8_t, MAX_FRAME_SIZE>;
+
+    std::size_t frame_size(bool const high_resolution) noexcept
+    {
+      return high_resolution ? MAX_FRAME_SIZE : Screen::WIDTH/8u*Screen::HEIGHT;
+    }
+
+    /**
+     * Only the pixels of the current resolution are stored. Rows are stored most significant byte first,
+     * so the bytes follow the pixels from left to right.
+     */
+    FrameBytes to_bytes(FrameBuffer const& frame) noexcept
+    {
+      FrameBytes bytes{};
+      auto const row_size = frame.width()/8u;
+      for (std::size_t y = 0; y<frame.height(); ++y) {
+        for (std::size_t n = 0; n<row_size; ++n) {
+          auto const word = n<8u ? frame.rows[y].high : frame.rows[y].low;
+          bytes[y*row_size+n] = static_cast<std::uint8_t>(word >> (56u-8u*(n%8u)));
+        }
+      }
+      return bytes;
+    }
+
+    FrameBuffer from_bytes(FrameBytes const& bytes, bool const high_resolution) noexcept
+    {
+      FrameBuffer frame{.rows = {}, .high_resolution = high_resolution};
+      auto const row_size = frame.width()/8u;
+      for (std::size_t y = 0; y<frame.height(); ++y) {
+        for (std::size_t n = 0; n<row_size; ++n) {
+          auto& word = n<8u ? frame.rows[y].high : frame.rows[y].low;
+          word = (word << 8) | bytes[y*row_size+n];
+        }
+      }
+      return frame;
+    }
+
+    void put_varint(std::vector<std::uint8_t>& out, std::uint64_t value)
+    {
+      while (value>=0x80u) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80u));
+        value >>= 7;
+      }
+      out.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    void put_u32(char* out, std::uint32_t const value) noexcept
+    {
+      for (int n = 0; n<4; ++n)
+        out[n] = static_cast<char>(value >> (8*n));
+    }
+
+    void put_u64(char* out, std::uint64_t const value) noexcept
+    {
+      for (int n = 0; n<8; ++n)
+        out[n] = static_cast<char>(value >> (8*n));
+    }
+
+    std::uint32_t get_u32(char const* in) noexcept
+    {
+      std::uint32_t value = 0u;
+      for (int n = 0; n<4; ++n)
+        value |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(in[n])) << (8*n);
+      return value;
+    }
+
+    std::uint64_t get_u64(char const* in) noexcept
+    {
+      std::uint64_t value = 0u;
+      for (int n = 0; n<8; ++n)
+        value |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(in[n])) << (8*n);
+      return value;
+    }
+
+    /**
+     * Encode the XOR of two frames of the same resolution as pairs of a zero run and a run of literal bytes.
+     *
+     * Trailing zeros are left out, so identical frames result in an empty delta.
+     */
+    void encode_delta(FrameBuffer const& previous, FrameBuffer const& frame, std::vector<std::uint8_t>& out)
+    {
+      FrameBuffer difference{.rows = {}, .high_resolution = frame.high_resolution};
+      for (std::size_t y = 0; y<frame.height(); ++y)
+        difference.rows[y] = previous.rows[y] ^ frame.rows[y];
+      auto const bytes = to_bytes(difference);
+      auto const end = bytes.begin()+static_cast<std::ptrdiff_t>(frame_size(frame.high_resolution));
+
+      std::size_t n = 0;
+      while (bytes.begin()+static_cast<std::ptrdiff_t>(n)<end) {
+        auto const zeros_end = std::find_if(bytes.begin()+n, end, [](auto const b) { return b!=0u; });
+        if (zeros_end==end)
+          break;
+        auto const literals_end = std::find(zeros_end, end, 0u);
+
+        put_varint(out, static_cast<std::uint64_t>(zeros_end-(bytes.begin()+n)));
+        put_varint(out, static_cast<std::uint64_t>(literals_end-zeros_end));
+        out.insert(out.end(), zeros_end, literals_end);
+        n = static_cast<std::size_t>(literals_end-bytes.begin());
+      }
+    }
+
+    /**
+     * Bounds checked cursor over a record.
+     */
+    class Cursor final {
+    public:
+      explicit Cursor(std::vector<std::uint8_t> const& data) noexcept
+          :data_{data}
+      {
+      }
+
+      [[nodiscard]] bool done() const noexcept
+      {
+        return offset_>=data_.size();
+      }
+
+      std::uint8_t byte()
+      {
+        if (offset_>=data_.size())
+          throw CaptureException{"Capture file is corrupted"};
+        return data_[offset_++];
+      }
+
+      std::uint64_t varint()
+      {
+        std::uint64_t value = 0u;
+        for (int shift = 0; shift<64; shift += 7) {
+          auto const b = byte();
+          value |= static_cast<std::uint64_t>(b & 0x7Fu) << shift;
+          if ((b & 0x80u)==0u)
+            return value;
+        }
+        throw CaptureException{"Capture file is corrupted"};
+      }
+
+    private:
+      std::vector<std::uint8_t> const& data_;
+      std::size_t offset_{0u};
+    };
+
+    FrameBuffer decode_delta(FrameBuffer const& previous, std::vector<std::uint8_t> const& record)
+    {
+      FrameBytes bytes = to_bytes(previous);
+      auto const size = frame_size(previous.high_resolution);
+      Cursor in{record};
+      std::uint64_t n = 0u;
+      while (!in.done()) {
+        n += in.varint();
+        auto const literals = in.varint();
+        if (n>size || literals>size-n)
+          throw CaptureException{"Capture file is corrupted"};
+        for (std::uint64_t end = n+literals; n<end; ++n)
+          bytes[n] ^= in.byte();
+      }
+      return from_bytes(bytes, previous.high_resolution);
+    }
+  }
+
+  FrameCaptureWriter::FrameCaptureWriter(std::filesystem::path const& path)
+      :file_{path, std::ios::binary | std::ios::trunc}
+  {
+    std::array<char, HEADER_SIZE> header{FILE_MAGIC[0], FILE_MAGIC[1], FILE_MAGIC[2], FILE_MAGIC[3],
+        static_cast<char>(VERSION), static_cast<char>(Screen::HIRES_WIDTH), static_cast<char>(Screen::HIRES_HEIGHT),
+        static_cast<char>(FRAME_RATE)};
+    if (!file_.write(header.data(), header.size()))
+      throw CaptureException{"Could not create capture file"};
+    offset_ = HEADER_SIZE;
+
+    record_.reserve(4u+2u*MAX_FRAME_SIZE);
+    thread_ = std::thread{[this] { write_frames(); }};
+  }
+
+  FrameCaptureWriter::~FrameCaptureWriter() noexcept
+  {
+    try {
+      close();
+    }
+    catch (...) {
+      // errors can only be reported by calling close() explicitly
+    }
+  }
+
+  void FrameCaptureWriter::capture(FrameBuffer const& frame)
+  {
+    if (queue_.push(frame))
+      return;
+
+    ++stalls_;
+    while (!queue_.push(frame))
+      std::this_thread::yield();
+  }
+
+  void FrameCaptureWriter::close()
+  {
+    if (!thread_.joinable())
+      return;
+
+    closing_.store(true, std::memory_order_release);
+    thread_.join();
+
+    write_index();
+    file_.close();
+    if (file_.fail())
+      throw CaptureException{"Could not write capture file"};
+  }
+
+  std::uint64_t FrameCaptureWriter::stalls() const noexcept
+  {
+    return stalls_;
+  }
+
+  void FrameCaptureWriter::write_frames()
+  {
+    using namespace std::chrono_literals;
+
+    while (true) {
+      // checked before looking at the queue, so no frame captured before closing can be missed
+      auto const closing = closing_.load(std::memory_order_acquire);
+      auto const frame = queue_.pop();
+      if (frame.has_value())
+        write_frame(*frame);
+      else if (closing)
+        return;
+      else
+        std::this_thread::sleep_for(1ms);
+    }
+  }
+
+  void FrameCaptureWriter::write_frame(FrameBuffer const& frame)
+  {
+    std::vector<std::uint8_t> payload{};
+    // deltas only work between frames of the same resolution
+    auto const keyframe = frames_%KEYFRAME_INTERVAL==0u || frame.high_resolution!=previous_.high_resolution;
+    std::uint8_t type = RecordType::DELTA;
+    if (keyframe) {
+      auto const bytes = to_bytes(frame);
+      payload.assign(bytes.begin(), bytes.begin()+static_cast<std::ptrdiff_t>(frame_size(frame.high_resolution)));
+      index_.push_back(IndexEntry{.frame = frames_, .offset = offset_});
+      type = frame.high_resolution ? RecordType::KEYFRAME | RecordType::HIGH_RESOLUTION : RecordType::KEYFRAME;
+    }
+    else {
+      encode_delta(previous_, frame, payload);
+    }
+
+    record_.clear();
+    record_.push_back(type);
+    put_varint(record_, payload.size());
+    record_.insert(record_.end(), payload.begin(), payload.end());
+    file_.write(reinterpret_cast<char const*>(record_.data()), static_cast<std::streamsize>(record_.size()));
+
+    offset_ += record_.size();
+    previous_ = frame;
+    ++frames_;
+  }
+
+  void FrameCaptureWriter::write_index()
+  {
+    std::array<char, 16u> entry{};
+    for (auto const& [frame, offset]: index_) {
+      put_u64(entry.data(), frame);
+      put_u64(entry.data()+8, offset);
+      file_.write(entry.data(), entry.size());
+    }
+
+    std::array<char, FOOTER_SIZE> footer{};
+    put_u64(footer.data(), offset_);
+    put_u64(footer.data()+8, frames_);
+    put_u32(footer.data()+16, static_cast<std::uint32_t>(index_.size()));
+    std::copy(INDEX_MAGIC.begin(), INDEX_MAGIC.end(), footer.begin()+20);
+    file_.write(footer.data(), footer.size());
+  }
+
+  FrameCaptureReader::FrameCaptureReader(std::filesystem::path const& path)
+      :file_{path, std::ios::binary}
+  {
+    std::array<char, HEADER_SIZE> header{};
+    if (!file_.read(header.data(), header.size()) || !std::equal(FILE_MAGIC.begin(), FILE_MAGIC.end(), header.begin())
+        || header[4]!=VERSION || static_cast<std::uint8_t>(header[5])!=Screen::HIRES_WIDTH
+        || static_cast<std::uint8_t>(header[6])!=Screen::HIRES_HEIGHT)
+      throw CaptureException{"Not a capture file"};
+    frame_rate_ = static_cast<std::uint8_t>(header[7]);
+
+    std::array<char, FOOTER_SIZE> footer{};
+    if (!file_.seekg(-static_cast<std::streamoff>(FOOTER_SIZE), std::ios::end) || !file_.read(footer.data(), footer.size())
+        || !std::equal(INDEX_MAGIC.begin(), INDEX_MAGIC.end(), footer.begin()+20))
+      throw CaptureException{"Capture file was not closed properly"};
+
+    records_end_ = get_u64(footer.data());
+    frame_count_ = get_u64(footer.data()+8);
+    auto const keyframes = get_u32(footer.data()+16);
+
+    file_.seekg(static_cast<std::streamoff>(records_end_));
+    std::array<char, 16u> entry{};
+    for (std::uint32_t n = 0; n<keyframes; ++n) {
+      if (!file_.read(entry.data(), entry.size()))
+        throw CaptureException{"Capture file is corrupted"};
+      index_.push_back(IndexEntry{.frame = get_u64(entry.data()), .offset = get_u64(entry.data()+8)});
+    }
+    if (frame_count_>0u && (index_.empty() || index_.front().frame!=0u))
+      throw CaptureException{"Capture file is corrupted"};
+
+    file_.seekg(HEADER_SIZE);
+  }
+
+  std::uint64_t FrameCaptureReader::frame_count() const noexcept
+  {
+    return frame_count_;
+  }
+
+  std::uint8_t FrameCaptureReader::frame_rate() const noexcept
+  {
+    return frame_rate_;
+  }
+
+  void FrameCaptureReader::seek(std::uint64_t const frame)
+  {
+    if (frame>=frame_count_)
+      throw CaptureException{"Frame does not exist"};
+
+    auto const keyframe = std::prev(std::upper_bound(index_.begin(), index_.end(), frame,
+        [](std::uint64_t const value, IndexEntry const& entry) { return value<entry.frame; }));
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(keyframe->offset));
+    position_ = keyframe->frame;
+    while (position_<frame)
+      next();
+  }
+
+  std::optional<FrameBuffer> FrameCaptureReader::next()
+  {
+    if (position_>=frame_count_)
+      return {};
+
+    auto const type = file_.get();
+    std::uint64_t length = 0u;
+    for (int shift = 0; ; shift += 7) {
+      auto const b = file_.get();
+      if (b==std::char_traits<char>::eof() || shift>=64)
+        throw CaptureException{"Capture file is corrupted"};
+      length |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+      if ((b & 0x80)==0)
+        break;
+    }
+    if (length>2u*MAX_FRAME_SIZE)
+      throw CaptureException{"Capture file is corrupted"};
+
+    record_.resize(length);
+    if (!file_.read(reinterpret_cast<char*>(record_.data()), static_cast<std::streamsize>(length)))
+      throw CaptureException{"Capture file is corrupted"};
+
+    if ((type & ~RecordType::HIGH_RESOLUTION)==RecordType::KEYFRAME) {
+      auto const high_resolution = (type & RecordType::HIGH_RESOLUTION)!=0;
+      if (length!=frame_size(high_resolution))
+        throw CaptureException{"Capture file is corrupted"};
+      FrameBytes bytes{};
+      std::copy(record_.begin(), record_.end(), bytes.begin());
+      previous_ = from_bytes(bytes, high_resolution);
+    }
+    else if (type==RecordType::DELTA) {
+      previous_ = decode_delta(previous_, record_);
+    }
+    else {
+      throw CaptureException{"Capture file is corrupted"};
+    }
+
+    ++position_;
+    return previous_;
+  }
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#ifndef CHIP8_VM_FRAME_CAPTURE_HXX
+#define CHIP8_VM_FRAME_CAPTURE_HXX
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "packed_screen.hxx"
+#include "ring_buffer.hxx"
+
+namespace chip8 {
+  /**
+   * Exception class being thrown when a frame capture cannot be written or read.
+   *
+   * Even though the class has the same functionality as its base,
+   * it exists for improved readability as it is more specific.
+   */
+  class CaptureException final : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+    using std::runtime_error::operator=;
+  };
+
+  /**
+   * Writes every captured frame to a file.
+   *
+   * Frames are stored as keyframes at a fixed interval and whenever the resolution changes, with the frames in between
+   * being the run length encoded XOR to their predecessor. An index of the keyframes at the end of the file allows
+   * for random access.
+   * Encoding and writing happens on a background thread, capture() only copies the frame into a queue.
+   */
+  class FrameCaptureWriter final {
+  public:
+    static std::uint32_t constexpr KEYFRAME_INTERVAL = 256u;
+    static std::size_t constexpr QUEUE_CAPACITY = 256u;
+    /**
+     * Frames per second of the capture, the processor ticks its timers at this rate.
+     */
+    static std::uint8_t constexpr FRAME_RATE = 60u;
+
+    /**
+     * Create the capture file and start the background writer.
+     *
+     * @param path The file to write the capture to. Existing files are overwritten.
+     * @throws CaptureException if the file cannot be created.
+     */
+    explicit FrameCaptureWriter(std::filesystem::path const& path);
+
+    FrameCaptureWriter(FrameCaptureWriter const&) = delete;
+
+    FrameCaptureWriter& operator=(FrameCaptureWriter const&) = delete;
+
+    /**
+     * Writes all pending frames and the index.
+     */
+    ~FrameCaptureWriter() noexcept;
+
+    /**
+     * Append a frame to the capture.
+     *
+     * Must always be called from the same thread. Only blocks when the background writer falls behind
+     * by more than QUEUE_CAPACITY frames.
+     *
+     * @param frame The frame to append.
+     */
+    void capture(FrameBuffer const& frame);
+
+    /**
+     * Write all pending frames and the index, then close the file.
+     *
+     * @throws CaptureException if writing failed.
+     */
+    void close();
+
+    /**
+     * Get the number of times capture() had to wait for the background writer.
+     *
+     * @return The number of stalls.
+     */
+    [[nodiscard]] std::uint64_t stalls() const noexcept;
+
+  private:
+    struct IndexEntry final {
+      std::uint64_t frame;
+      std::uint64_t offset;
+    };
+
+    std::ofstream file_;
+    RingBuffer<FrameBuffer, QUEUE_CAPACITY> queue_{};
+    std::atomic<bool> closing_{false};
+    std::uint64_t stalls_{0u};
+    std::thread thread_;
+
+    // encoder state, only touched by the background thread
+    FrameBuffer previous_{};
+    std::uint64_t frames_{0u};
+    std::uint64_t offset_{0u};
+    std::vector<IndexEntry> index_{};
+    std::vector<std::uint8_t> record_{};
+
+    void write_frames();
+
+    void write_frame(FrameBuffer const& frame);
+
+    void write_index();
+  };
+
+  /**
+   * Reads a capture written by FrameCaptureWriter.
+   */
+  class FrameCaptureReader final {
+  public:
+    /**
+     * Open a capture file.
+     *
+     * @param path The capture file to read.
+     * @throws CaptureException if the file cannot be opened, is not a capture or was not closed properly.
+     */
+    explicit FrameCaptureReader(std::filesystem::path const& path);
+
+    [[nodiscard]] std::uint64_t frame_count() const noexcept;
+
+    [[nodiscard]] std::uint8_t frame_rate() const noexcept;
+
+    /**
+     * Continue reading at the given frame, starting to decode at the closest keyframe before it.
+     *
+     * @param frame The number of the frame next() returns next.
+     * @throws CaptureException if the frame does not exist or the capture is corrupted.
+     */
+    void seek(std::uint64_t frame);
+
+    /**
+     * Read the next frame.
+     *
+     * @return The next frame or an empty optional after the last frame.
+     * @throws CaptureException if the capture is corrupted.
+     */
+    std::optional<FrameBuffer> next();
+
+  private:
+    struct IndexEntry final {
+      std::uint64_t frame;
+      std::uint64_t offset;
+    };
+
+    std::ifstream file_;
+    std::uint8_t frame_rate_{0u};
+    std::uint64_t frame_count_{0u};
+    std::uint64_t records_end_{0u};
+    std::vector<IndexEntry> index_{};
+    std::uint64_t position_{0u};
+    FrameBuffer previous_{};
+    std::vector<std::uint8_t> record_{};
+  };
+}
+
+#endif // CHIP8_VM_FRAME_CAPTURE_HXX
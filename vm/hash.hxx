@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef CHIP8_VM_HASH_HXX
+#define CHIP8_VM_HASH_HXX
+
+#include <cstdint>
+#include <span>
+
+namespace chip8 {
+  /**
+   * Scramble a 64 bit value (the finaliser of splitmix64).
+   *
+   * @param value The value to scramble.
+   * @return The scrambled value.
+   */
+  constexpr std::uint64_t mix64(std::uint64_t value) noexcept
+  {
+    value = (value ^ (value >> 30))*0xBF58476D1CE4E5B9u;
+    value = (value ^ (value >> 27))*0x94D049BB133111EBu;
+    return value ^ (value >> 31);
+  }
+
+  /**
+   * Combine a running hash with another value.
+   *
+   * @param seed The running hash.
+   * @param value The value to add to the hash.
+   * @return The combined hash.
+   */
+  constexpr std::uint64_t hash_combine(std::uint64_t const seed, std::uint64_t const value) noexcept
+  {
+    return mix64(seed ^ (value+0x9E3779B97F4A7C15u+(seed << 6)+(seed >> 2)));
+  }
+
+  /**
+   * Hash a sequence of bytes with 64 bit FNV-1a.
+   *
+   * @param data The bytes to hash.
+   * @return The hash of the bytes.
+   */
+  constexpr std::uint64_t fnv1a64(std::span<std::uint8_t const> const data) noexcept
+  {
+    std::uint64_t hash = 0xCBF29CE484222325u;
+    for (auto const byte: data) {
+      hash ^= byte;
+      hash *= 0x100000001B3u;
+    }
+    return hash;
+  }
+}
+
+#endif // CHIP8_VM_HASH_HXX
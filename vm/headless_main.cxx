@@ -0,0 +1,435 @@
+#include <call_stack.hxx>
+#include <frame_capture.hxx>
+#include <input_latency.hxx>
+#include <memory.hxx>
+#include <metrics.hxx>
+#include <metrics_socket.hxx>
+#include <packed_screen.hxx>
+#include <processor.hxx>
+#include <rom_store.hxx>
+#include <shared_memory_screen.hxx>
+#include <terminal_screen.hxx>
+#include <trace.hxx>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+namespace {
+  // terminals only report key presses, so keys are released again after a while
+  auto constexpr KEY_HOLD_TIME = 150ms;
+
+  std::atomic<bool> interrupted = false;
+
+  class StderrLogger final : public chip8::Logger {
+    void debug(char const*, std::source_location) override
+    {
+    }
+
+    [[nodiscard]] bool debug_enabled() const noexcept override
+    {
+      return false;
+    }
+
+    void warn(char const* message, std::source_location const where) override
+    {
+      std::fprintf(stderr, "%s:%d:%d: %s\n", where.file_name(), static_cast<int>(where.line()),
+          static_cast<int>(where.column()), message);
+    }
+
+    void error(char const* message, std::source_location const where) override
+    {
+      std::fprintf(stderr, "%s:%d:%d: %s\n", where.file_name(), static_cast<int>(where.line()),
+          static_cast<int>(where.column()), message);
+    }
+  };
+
+  /**
+   * Puts the terminal into raw, non-blocking mode for as long as it exists.
+   */
+  class RawTerminal final {
+  public:
+    explicit RawTerminal(int const fd) noexcept
+        :fd_{fd}
+    {
+      if (!isatty(fd_) || tcgetattr(fd_, &original_)!=0)
+        return;
+
+      auto raw = original_;
+      raw.c_lflag &= ~(ICANON | ECHO);
+      raw.c_cc[VMIN] = 0;
+      raw.c_cc[VTIME] = 0;
+      active_ = tcsetattr(fd_, TCSANOW, &raw)==0;
+      flags_ = fcntl(fd_, F_GETFL);
+      fcntl(fd_, F_SETFL, flags_ | O_NONBLOCK);
+    }
+
+    RawTerminal(RawTerminal const&) = delete;
+
+    RawTerminal& operator=(RawTerminal const&) = delete;
+
+    ~RawTerminal() noexcept
+    {
+      if (active_) {
+        tcsetattr(fd_, TCSANOW, &original_);
+        fcntl(fd_, F_SETFL, flags_);
+      }
+    }
+
+    [[nodiscard]] bool active() const noexcept
+    {
+      return active_;
+    }
+
+  private:
+    int fd_;
+    termios original_{};
+    int flags_{0};
+    bool active_{false};
+  };
+
+  std::optional<std::uint8_t> key_for(char const c)
+  {
+    switch (c) {
+    default:
+      return {};
+    case '1':
+      return 0x1;
+    case '2':
+      return 0x2;
+    case '3':
+      return 0x3;
+    case '4':
+      return 0xC;
+    case 'q':
+      return 0x4;
+    case 'w':
+      return 0x5;
+    case 'e':
+      return 0x6;
+    case 'r':
+      return 0xD;
+    case 'a':
+      return 0x7;
+    case 's':
+      return 0x8;
+    case 'd':
+      return 0x9;
+    case 'f':
+      return 0xE;
+    case 'z':
+      return 0xA;
+    case 'x':
+      return 0x0;
+    case 'c':
+      return 0xB;
+    case 'v':
+      return 0xF;
+    }
+  }
+
+  struct Options final {
+    std::vector<char const*> positional{};
+    std::optional<std::filesystem::path> trace{};
+    std::optional<std::filesystem::path> capture{};
+    std::optional<std::filesystem::path> metrics_file{};
+    std::optional<std::filesystem::path> metrics_socket{};
+    bool trace_latency{false};
+    /**
+     * Empty to detect the profile from the ROM.
+     */
+    std::optional<chip8::QuirkProfile> quirks{chip8::QuirkProfile::Cosmac};
+    std::optional<std::uint64_t> cycles{};
+    bool terminal{true};
+    std::optional<std::string> shared_memory{};
+    bool uncapped{false};
+  };
+
+  Options parse_options(int const argc, char** argv)
+  {
+    Options options{};
+    for (int n = 1; n<argc; ++n) {
+      std::string_view const arg{argv[n]};
+      if (arg.starts_with("--trace="))
+        options.trace = arg.substr(8);
+      else if (arg.starts_with("--capture="))
+        options.capture = arg.substr(10);
+      else if (arg.starts_with("--metrics=unix:"))
+        options.metrics_socket = arg.substr(15);
+      else if (arg.starts_with("--metrics="))
+        options.metrics_file = arg.substr(10);
+      else if (arg.starts_with("--cycles="))
+        options.cycles = std::stoull(std::string{arg.substr(9)});
+      else if (arg=="--screen=none")
+        options.terminal = false;
+      else if (arg=="--screen=terminal")
+        options.terminal = true;
+      else if (arg.starts_with("--screen=shm:")) {
+        options.terminal = false;
+        options.shared_memory = arg.substr(13);
+      }
+      else if (arg=="--trace-latency")
+        options.trace_latency = true;
+      else if (arg=="--uncapped")
+        options.uncapped = true;
+      else if (arg=="--quirks=chip48")
+        options.quirks = chip8::QuirkProfile::Chip48;
+      else if (arg=="--quirks=schip")
+        options.quirks = chip8::QuirkProfile::SuperChip;
+      else if (arg=="--quirks=cosmac")
+        options.quirks = chip8::QuirkProfile::Cosmac;
+      else if (arg=="--quirks=auto")
+        options.quirks.reset();
+      else
+        options.positional.push_back(argv[n]);
+    }
+    return options;
+  }
+
+  /**
+   * Run the processor on its own thread while the calling thread handles input and output.
+   *
+   * Timers are derived from the executed cycles, so runs without pacing behave exactly like paced ones.
+   * When capturing, a frame is captured on every timer tick. Shared memory frames are published on timer ticks as well,
+   * as only the processor thread sees complete frames.
+   *
+   * @return true, if the processor ran into an error.
+   */
+  template<typename Processor>
+  bool run_session(Processor& processor, chip8::PackedScreen const& screen, chip8::TerminalScreen* terminal,
+      chip8::SharedMemoryScreen* shared_memory, chip8::FrameCaptureWriter* capture, chip8::EmulatorMetrics* metrics,
+      chip8::InputLatencyTracer* latency, Options const& options)
+  {
+    std::atomic<bool> run = true;
+    std::atomic<bool> failed = false;
+
+    std::thread vm_thread{[&] {
+      auto const batch = chip8::CYCLES_PER_TIMER_TICK;
+      auto next = std::chrono::steady_clock::now();
+      while (run) {
+        auto end = processor.cycles()+batch;
+        if (options.cycles.has_value() && *options.cycles<=end) {
+          end = *options.cycles;
+          run = false;
+        }
+        auto const result = processor.run_until(end);
+        if (result.reason!=chip8::StopReason::BudgetExhausted) {
+          failed = true;
+          run = false;
+        }
+        processor.update_timers();
+        if (capture!=nullptr)
+          capture->capture(screen.frame());
+        if (shared_memory!=nullptr) {
+          auto const started = std::chrono::steady_clock::now();
+          if (shared_memory->publish() && latency!=nullptr)
+            latency->presented(started, std::chrono::steady_clock::now());
+        }
+        if (metrics!=nullptr) {
+          metrics->instructions.add(result.cycles);
+          metrics->frames.add();
+        }
+
+        if (!options.uncapped) {
+          next += chip8::INSTRUCTION_TIME*batch;
+          if (metrics!=nullptr)
+            metrics->timer_drift.set(std::chrono::steady_clock::now()-next);
+          std::this_thread::sleep_until(next);
+          if (metrics!=nullptr)
+            metrics->sleep_overshoot.observe(std::chrono::steady_clock::now()-next);
+        }
+      }
+    }};
+
+    RawTerminal const raw_terminal{STDIN_FILENO};
+    std::array<std::optional<std::chrono::steady_clock::time_point>, 16u> release_at{};
+
+    while (run && !interrupted) {
+      auto const now = std::chrono::steady_clock::now();
+      for (std::uint8_t key = 0; key<release_at.size(); ++key) {
+        if (release_at[key].has_value() && *release_at[key]<=now) {
+          processor.toggle_key(key, false);
+          release_at[key].reset();
+        }
+      }
+
+      std::array<char, 64u> input{};
+      auto const count = raw_terminal.active() ? read(STDIN_FILENO, input.data(), input.size()) : 0;
+      for (ssize_t n = 0; n<count; ++n) {
+        if (auto const key = key_for(input[n]); key.has_value()) {
+          processor.toggle_key(*key, true);
+          release_at[*key] = now+KEY_HOLD_TIME;
+        }
+      }
+
+      if (shared_memory!=nullptr)
+        shared_memory->forward_keys(processor);
+
+      if (terminal!=nullptr) {
+        auto const started = std::chrono::steady_clock::now();
+        if (terminal->present()>0u) {
+          auto const presented_at = std::chrono::steady_clock::now();
+          if (metrics!=nullptr)
+            metrics->render.observe(presented_at-started);
+          if (latency!=nullptr)
+            latency->presented(started, presented_at);
+        }
+      }
+      std::this_thread::sleep_for(terminal!=nullptr || shared_memory!=nullptr ? 4ms : 10ms);
+    }
+
+    run = false;
+    vm_thread.join();
+    return failed;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  auto const options = parse_options(argc, argv);
+  if (options.positional.empty()) {
+    std::fprintf(stderr, "Usage: ./chip_8_headless [rom] {--screen=terminal|none|shm:name} {--cycles=count} "
+                         "{--uncapped} {--quirks=cosmac|chip48|schip|auto} {--trace=file} {--capture=file} "
+                         "{--metrics=file|unix:path} {--trace-latency}\n");
+    return 2;
+  }
+
+  chip8::RomStore roms;
+  std::shared_ptr<chip8::Rom const> rom{};
+  try {
+    rom = roms.open(options.positional[0]);
+  }
+  catch (chip8::RomException const& ex) {
+    std::fprintf(stderr, "%s\n", ex.what());
+    return 2;
+  }
+
+  std::unique_ptr<chip8::TraceWriter> tracer{};
+  if (options.trace.has_value()) {
+    try {
+      tracer = std::make_unique<chip8::TraceWriter>(*options.trace);
+    }
+    catch (chip8::TraceException const& ex) {
+      std::fprintf(stderr, "%s\n", ex.what());
+      return 2;
+    }
+  }
+
+  std::unique_ptr<chip8::FrameCaptureWriter> capture{};
+  if (options.capture.has_value()) {
+    try {
+      capture = std::make_unique<chip8::FrameCaptureWriter>(*options.capture);
+    }
+    catch (chip8::CaptureException const& ex) {
+      std::fprintf(stderr, "%s\n", ex.what());
+      return 2;
+    }
+  }
+
+  // the metrics are only registered and updated when they are exported
+  chip8::MetricsRegistry registry;
+  std::optional<chip8::EmulatorMetrics> metrics{};
+  std::unique_ptr<chip8::MetricsFileExporter> metrics_file{};
+  std::unique_ptr<chip8::MetricsSocketExporter> metrics_socket{};
+  if (options.metrics_file.has_value() || options.metrics_socket.has_value()) {
+    metrics.emplace(registry);
+    try {
+      if (options.metrics_file.has_value())
+        metrics_file = std::make_unique<chip8::MetricsFileExporter>(registry, *options.metrics_file);
+      if (options.metrics_socket.has_value())
+        metrics_socket = std::make_unique<chip8::MetricsSocketExporter>(registry, *options.metrics_socket);
+    }
+    catch (chip8::MetricsException const& ex) {
+      std::fprintf(stderr, "%s\n", ex.what());
+      return 2;
+    }
+  }
+  auto* const emulator_metrics = metrics.has_value() ? &*metrics : nullptr;
+
+  std::signal(SIGINT, [](int) { interrupted = true; });
+  std::signal(SIGTERM, [](int) { interrupted = true; });
+
+  std::unique_ptr<chip8::PackedScreen> screen{};
+  chip8::TerminalScreen* terminal = nullptr;
+  chip8::SharedMemoryScreen* shared_memory = nullptr;
+  if (options.shared_memory.has_value()) {
+    try {
+      auto shared_memory_screen = std::make_unique<chip8::SharedMemoryScreen>(*options.shared_memory);
+      shared_memory = shared_memory_screen.get();
+      screen = std::move(shared_memory_screen);
+    }
+    catch (chip8::SharedMemoryException const& ex) {
+      std::fprintf(stderr, "%s\n", ex.what());
+      return 2;
+    }
+  }
+  else if (options.terminal) {
+    auto terminal_screen = std::make_unique<chip8::TerminalScreen>(STDOUT_FILENO);
+    terminal = terminal_screen.get();
+    screen = std::move(terminal_screen);
+  }
+  else {
+    screen = std::make_unique<chip8::PackedScreen>();
+  }
+
+  StderrLogger logger;
+  chip8::NullAudio audio;
+  chip8::CallStack call_stack;
+  chip8::Memory memory;
+  memory.load(chip8::Processor::CODE_START, rom->bytes());
+
+  std::optional<chip8::InputLatencyTracer> latency{};
+  if (options.trace_latency)
+    latency.emplace();
+  auto* const latency_tracer = latency.has_value() ? &*latency : nullptr;
+
+  auto const quirks = options.quirks.value_or(rom->quirk_profile());
+  auto const failed = chip8::with_quirk_profile(quirks, [&]<typename Quirks>(std::type_identity<Quirks>) {
+    chip8::BasicProcessor<Quirks> processor{Quirks{}, call_stack, memory, *screen, audio, logger};
+    processor.set_tracer(tracer.get());
+    processor.set_metrics(emulator_metrics);
+    processor.set_latency_tracer(latency_tracer);
+    return run_session(processor, *screen, terminal, shared_memory, capture.get(), emulator_metrics, latency_tracer,
+        options);
+  });
+
+  screen.reset();
+  if (tracer) {
+    try {
+      tracer->close();
+    }
+    catch (chip8::TraceException const& ex) {
+      std::fprintf(stderr, "%s\n", ex.what());
+    }
+  }
+  if (capture) {
+    try {
+      capture->close();
+    }
+    catch (chip8::CaptureException const& ex) {
+      std::fprintf(stderr, "%s\n", ex.what());
+    }
+    if (capture->stalls()>0u)
+      std::fprintf(stderr, "Capture stalled the processor %llu times\n",
+          static_cast<unsigned long long>(capture->stalls()));
+  }
+  if (latency.has_value())
+    latency->report(std::cerr);
+  return failed ? 1 : 0;
+}
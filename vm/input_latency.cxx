@@ -0,0 +1,106 @@
+#include "input_latency.hxx"
+#include "processor.hxx"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace chip8 {
+  namespace {
+    std::uint64_t now() noexcept
+    {
+      auto const time = std::chrono::steady_clock::now().time_since_epoch();
+      return static_cast<std::uint64_t>(std::chrono::nanoseconds{time}.count());
+    }
+
+    /**
+     * Get the nearest-rank percentile of sorted values.
+     */
+    std::uint64_t percentile(std::vector<std::uint64_t> const& sorted, unsigned const percent)
+    {
+      auto const rank = (sorted.size()*percent+99u)/100u;
+      return sorted[std::max<std::size_t>(rank, 1u)-1u];
+    }
+  }
+
+  void InputLatencyTracer::applied(KeyEvent const& event)
+  {
+    applied_[event.key] = Sample{
+        .key = event.key,
+        .pressed = event.pressed,
+        .queued_at = event.queued_at,
+        .applied_at = now(),
+        .observed_at = 0u,
+        .drawn_at = 0u,
+    };
+  }
+
+  void InputLatencyTracer::observed(std::uint8_t const key)
+  {
+    if (key>=applied_.size() || !applied_[key].has_value())
+      return;
+
+    auto sample = *applied_[key];
+    applied_[key].reset();
+    sample.observed_at = now();
+    observed_.push_back(sample);
+  }
+
+  void InputLatencyTracer::drawn()
+  {
+    if (observed_.empty())
+      return;
+
+    auto const drawn_at = now();
+    for (auto sample: observed_) {
+      sample.drawn_at = drawn_at;
+      // dropping samples when the frontend does not present is better than blocking the processor
+      drawn_.push(sample);
+    }
+    observed_.clear();
+  }
+
+  void InputLatencyTracer::presented(std::chrono::steady_clock::time_point const taken_at,
+      std::chrono::steady_clock::time_point const presented_at)
+  {
+    auto const frame_taken_at = static_cast<std::uint64_t>(
+        std::chrono::nanoseconds{taken_at.time_since_epoch()}.count());
+    auto const frame_presented_at = static_cast<std::uint64_t>(
+        std::chrono::nanoseconds{presented_at.time_since_epoch()}.count());
+    while (auto const* sample = drawn_.front()) {
+      // samples drawn after the frame was taken show up in the next one
+      if (sample->drawn_at>frame_taken_at)
+        break;
+
+      latencies_[static_cast<std::size_t>(Stage::Apply)].push_back(sample->applied_at-sample->queued_at);
+      latencies_[static_cast<std::size_t>(Stage::Observe)].push_back(sample->observed_at-sample->applied_at);
+      latencies_[static_cast<std::size_t>(Stage::Draw)].push_back(sample->drawn_at-sample->observed_at);
+      latencies_[static_cast<std::size_t>(Stage::Present)].push_back(frame_presented_at-sample->drawn_at);
+      latencies_[static_cast<std::size_t>(Stage::Total)].push_back(frame_presented_at-sample->queued_at);
+      drawn_.pop();
+    }
+  }
+
+  void InputLatencyTracer::report(std::ostream& out) const
+  {
+    static std::array<char const*, STAGES> constexpr NAMES{"apply", "observe", "draw", "present", "total"};
+
+    auto const samples = latencies_[static_cast<std::size_t>(Stage::Total)].size();
+    out << "Input latency of " << samples << " key events in ms\n";
+    if (samples==0u)
+      return;
+
+    out << std::left << std::setw(10) << "stage" << std::right;
+    for (auto const* const column: {"p50", "p90", "p99", "max"})
+      out << std::setw(10) << column;
+    out << '\n';
+    out << std::fixed << std::setprecision(3);
+    for (std::size_t stage = 0; stage<STAGES; ++stage) {
+      auto sorted = latencies_[stage];
+      std::ranges::sort(sorted);
+      out << std::left << std::setw(10) << NAMES[stage] << std::right;
+      for (auto const percent: {50u, 90u, 99u, 100u})
+        out << std::setw(10) << static_cast<double>(percentile(sorted, percent))/1e6;
+      out << '\n';
+    }
+  }
+}
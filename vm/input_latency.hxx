@@ -0,0 +1,112 @@
+#pragma once
+
+#ifndef CHIP8_VM_INPUT_LATENCY_HXX
+#define CHIP8_VM_INPUT_LATENCY_HXX
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "ring_buffer.hxx"
+
+namespace chip8 {
+  struct KeyEvent;
+
+  /**
+   * Follows key events from the frontend to the display and reports how long every stage took.
+   *
+   * An event is queued by the frontend, applied by the processor, observed by the first instruction reading the key
+   * (Ex9E, ExA1 or a completing Fx0A), drawn by the next sprite and finally presented by the frontend.
+   * The processor thread reports the first four stages, the frontend thread the last one.
+   * All timestamps are nanoseconds of std::chrono::steady_clock, like KeyEvent::queued_at.
+   */
+  class InputLatencyTracer final {
+  public:
+    enum class Stage {
+      /**
+       * From the frontend queueing the event until the processor applies it.
+       */
+      Apply,
+      /**
+       * From applying the event until an instruction reads the key.
+       */
+      Observe,
+      /**
+       * From reading the key until the next sprite is drawn.
+       */
+      Draw,
+      /**
+       * From drawing the sprite until the frontend presents a frame containing it.
+       */
+      Present,
+      /**
+       * From the frontend queueing the event until it presents the result.
+       */
+      Total,
+    };
+
+    static std::size_t constexpr STAGES = 5u;
+    static std::size_t constexpr QUEUE_CAPACITY = 256u;
+
+    /**
+     * Record that the processor applied a key event. Must be called from the processor thread.
+     *
+     * A later event for the same key replaces this one if no instruction read the key in between.
+     *
+     * @param event The applied event.
+     */
+    void applied(KeyEvent const& event);
+
+    /**
+     * Record that an instruction read a key. Must be called from the processor thread.
+     *
+     * @param key The key the instruction read.
+     */
+    void observed(std::uint8_t key);
+
+    /**
+     * Record that a sprite was drawn. Must be called from the processor thread.
+     */
+    void drawn();
+
+    /**
+     * Record that the frontend presented a frame. Must always be called from the same thread.
+     *
+     * @param taken_at The time just before the frontend took the frame from the screen.
+     * @param presented_at The time the frame was shown, after waiting for the display if presenting does.
+     */
+    void presented(std::chrono::steady_clock::time_point taken_at,
+        std::chrono::steady_clock::time_point presented_at);
+
+    /**
+     * Write the percentiles of every stage. Must be called from the thread calling presented().
+     *
+     * @param out The stream to write the report to.
+     */
+    void report(std::ostream& out) const;
+
+  private:
+    struct Sample final {
+      std::uint8_t key;
+      bool pressed;
+      std::uint64_t queued_at;
+      std::uint64_t applied_at;
+      std::uint64_t observed_at;
+      std::uint64_t drawn_at;
+    };
+
+    // only touched by the processor thread
+    std::array<std::optional<Sample>, 16u> applied_{};
+    std::vector<Sample> observed_{};
+
+    RingBuffer<Sample, QUEUE_CAPACITY> drawn_{};
+
+    // only touched by the frontend thread
+    std::array<std::vector<std::uint64_t>, STAGES> latencies_{};
+  };
+}
+
+#endif // CHIP8_VM_INPUT_LATENCY_HXX
@@ -0,0 +1,49 @@
+#include "lockstep.hxx"
+
+#include <iomanip>
+#include <sstream>
+
+namespace chip8 {
+  namespace {
+    void describe(std::ostream& out, char const* name, ProcessorState const& state)
+    {
+      out << name << ": pc=0x" << std::setw(3) << static_cast<std::uint16_t>(state.pc)
+          << " i=0x" << std::setw(3) << static_cast<std::uint16_t>(state.i)
+          << " dt=0x" << std::setw(2) << static_cast<int>(state.delay_timer)
+          << " st=0x" << std::setw(2) << static_cast<int>(state.sound_timer)
+          << " keys=0x" << std::setw(4) << state.keys
+          << " v=";
+      for (auto const value: state.v)
+        out << std::setw(2) << static_cast<int>(value);
+      out << '\n';
+    }
+  }
+
+  std::string to_string(Divergence const& divergence)
+  {
+    std::ostringstream out;
+    out << std::hex << std::setfill('0');
+    if (divergence.reproducible) {
+      out << "Engines diverge at instruction 0x" << std::setw(4) << divergence.opcode
+          << " at 0x" << std::setw(3) << static_cast<std::uint16_t>(divergence.pc)
+          << " after " << std::dec << divergence.cycle << std::hex << " cycles\n";
+    }
+    else {
+      out << "Engines diverge in the block starting after " << std::dec << divergence.cycle << std::hex
+          << " cycles, but replaying it does not reproduce the divergence\n";
+    }
+
+    describe(out, "reference", divergence.reference);
+    describe(out, "candidate", divergence.candidate);
+
+    auto const& reference = divergence.reference_digest;
+    auto const& candidate = divergence.candidate_digest;
+    if (reference.processor!=candidate.processor)
+      out << "processor state differs\n";
+    if (reference.memory!=candidate.memory)
+      out << "memory differs\n";
+    if (reference.screen!=candidate.screen)
+      out << "screen differs\n";
+    return out.str();
+  }
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#ifndef CHIP8_VM_LOCKSTEP_HXX
+#define CHIP8_VM_LOCKSTEP_HXX
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "machine.hxx"
+
+namespace chip8 {
+  /**
+   * Anything that can be run in lockstep, usually one of the BasicMachine instantiations.
+   */
+  template<typename T>
+  concept LockstepEngine = requires(T& engine, T const& view, typename T::Snapshot const& snapshot) {
+    { engine.step() } -> std::same_as<bool>;
+    { engine.advance(std::uint64_t{}) } -> std::same_as<std::uint64_t>;
+    { view.halted() } -> std::same_as<bool>;
+    { view.digest() } -> std::same_as<MachineDigest>;
+    { view.snapshot() } -> std::same_as<typename T::Snapshot>;
+    engine.restore(snapshot);
+    engine.processor().toggle_key(std::uint8_t{}, bool{});
+    engine.processor().process_input();
+    { view.processor().state() } -> std::same_as<ProcessorState>;
+    { view.processor().pc() } -> std::same_as<Address>;
+    { view.memory() } -> std::convertible_to<Memory const&>;
+  };
+
+  /**
+   * The first instruction after which two engines disagreed.
+   */
+  struct Divergence final {
+    /**
+     * The number of instructions both engines executed in agreement.
+     */
+    std::uint64_t cycle{0u};
+    Address pc{};
+    std::uint16_t opcode{0u};
+    ProcessorState reference{};
+    ProcessorState candidate{};
+    MachineDigest reference_digest{};
+    MachineDigest candidate_digest{};
+    /**
+     * false, if replaying the block did not show the divergence again, i.e. one of the engines is not deterministic.
+     * The other fields then describe the end of the block instead of a single instruction.
+     */
+    bool reproducible{false};
+  };
+
+  /**
+   * Describe a divergence for humans.
+   *
+   * @param divergence The divergence to describe.
+   * @return The instruction and the differing parts of both states.
+   */
+  std::string to_string(Divergence const& divergence);
+
+  /**
+   * Runs two engines on the same program and input and reports where they stop agreeing.
+   *
+   * Only the digests are compared at the end of every block. When they differ, both engines are restored to the
+   * beginning of the block and replay it instruction by instruction to find the first divergent one, so checking
+   * long runs costs little more than executing them.
+   *
+   * @tparam Reference The engine whose behaviour is trusted.
+   * @tparam Candidate The engine being verified.
+   */
+  template<LockstepEngine Reference, LockstepEngine Candidate>
+  class Lockstep final {
+  public:
+    /**
+     * By default the engines are compared once per frame.
+     */
+    static std::uint64_t constexpr DEFAULT_BLOCK_SIZE = CYCLES_PER_TIMER_TICK;
+
+    /**
+     * Set up the comparison. Both engines must have the same program loaded and be in the same state.
+     *
+     * @param reference The trusted engine.
+     * @param candidate The engine being verified.
+     * @param block_size The number of instructions between comparisons.
+     */
+    Lockstep(Reference& reference, Candidate& candidate, std::uint64_t const block_size = DEFAULT_BLOCK_SIZE) noexcept
+        :reference_{reference}, candidate_{candidate}, block_size_{std::max<std::uint64_t>(block_size, 1u)}
+    {
+    }
+
+    /**
+     * Press or release a key on both engines, effective before the next instruction.
+     *
+     * @param key The key (0x0-0xF).
+     * @param pressed true, if the key was pressed, false if it was released.
+     */
+    void toggle_key(std::uint8_t const key, bool const pressed)
+    {
+      reference_.processor().toggle_key(key, pressed);
+      reference_.processor().process_input();
+      candidate_.processor().toggle_key(key, pressed);
+      candidate_.processor().process_input();
+    }
+
+    /**
+     * Run both engines.
+     *
+     * @param cycles The number of instructions to run. Fewer are executed when both engines halt.
+     * @return The first divergent instruction or an empty optional if the engines agreed.
+     */
+    std::optional<Divergence> run(std::uint64_t cycles)
+    {
+      while (cycles>0u && !(reference_.halted() && candidate_.halted())) {
+        auto const block = std::min(cycles, block_size_);
+        auto const reference_start = reference_.snapshot();
+        auto const candidate_start = candidate_.snapshot();
+
+        auto const reference_executed = reference_.advance(block);
+        auto const candidate_executed = candidate_.advance(block);
+        if (reference_executed!=candidate_executed || reference_.digest()!=candidate_.digest()) {
+          reference_.restore(reference_start);
+          candidate_.restore(candidate_start);
+          return locate(block);
+        }
+
+        cycles -= block;
+        executed_ += reference_executed;
+      }
+      return {};
+    }
+
+    /**
+     * Get the number of instructions both engines executed in agreement.
+     *
+     * @return The number of verified instructions.
+     */
+    [[nodiscard]] std::uint64_t executed() const noexcept
+    {
+      return executed_;
+    }
+
+  private:
+    Reference& reference_;
+    Candidate& candidate_;
+    std::uint64_t block_size_;
+    std::uint64_t executed_{0u};
+
+    Divergence locate(std::uint64_t const block)
+    {
+      Divergence divergence{};
+      for (std::uint64_t n = 0; n<block; ++n) {
+        divergence.cycle = executed_;
+        divergence.pc = reference_.processor().pc();
+        divergence.opcode = static_cast<std::uint16_t>(
+            (reference_.memory()[divergence.pc] << 8) | reference_.memory()[divergence.pc+1]);
+
+        auto const reference_stepped = !reference_.halted() && reference_.step();
+        auto const candidate_stepped = !candidate_.halted() && candidate_.step();
+        divergence.reference_digest = reference_.digest();
+        divergence.candidate_digest = candidate_.digest();
+        if (reference_stepped!=candidate_stepped || divergence.reference_digest!=divergence.candidate_digest) {
+          divergence.reference = reference_.processor().state();
+          divergence.candidate = candidate_.processor().state();
+          divergence.reproducible = true;
+          return divergence;
+        }
+        ++executed_;
+      }
+
+      divergence.reference = reference_.processor().state();
+      divergence.candidate = candidate_.processor().state();
+      divergence.reproducible = false;
+      return divergence;
+    }
+  };
+}
+
+#endif // CHIP8_VM_LOCKSTEP_HXX
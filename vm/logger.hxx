@@ -20,6 +20,38 @@ namespace chip8 {
     virtual void warn(char const* message, std::source_location where = std::source_location::current()) = 0;
 
     virtual void error(char const* message, std::source_location where = std::source_location::current()) = 0;
+
+    /**
+     * Check whether debug messages are shown at all, so callers can skip formatting them.
+     *
+     * @return true, if debug messages are shown, false otherwise.
+     */
+    [[nodiscard]] virtual bool debug_enabled() const noexcept
+    {
+      return true;
+    }
+  };
+
+  /**
+   * Logger discarding all messages, for machines nobody watches.
+   */
+  struct NullLogger final : Logger {
+    void debug(char const*, std::source_location) override
+    {
+    }
+
+    void warn(char const*, std::source_location) override
+    {
+    }
+
+    void error(char const*, std::source_location) override
+    {
+    }
+
+    [[nodiscard]] bool debug_enabled() const noexcept override
+    {
+      return false;
+    }
   };
 }
 
@@ -0,0 +1,222 @@
+#pragma once
+
+#ifndef CHIP8_VM_MACHINE_HXX
+#define CHIP8_VM_MACHINE_HXX
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+
+#include "audio.hxx"
+#include "call_stack.hxx"
+#include "hash.hxx"
+#include "logger.hxx"
+#include "memory.hxx"
+#include "packed_screen.hxx"
+#include "processor.hxx"
+
+namespace chip8 {
+  /**
+   * Hashes of the complete state of a machine.
+   *
+   * Cheap enough to be compared after every block of instructions.
+   */
+  struct MachineDigest final {
+    std::uint64_t processor{0u};
+    std::uint64_t memory{0u};
+    std::uint64_t screen{0u};
+
+    bool operator==(MachineDigest const&) const noexcept = default;
+  };
+
+  /**
+   * A processor bundled with everything it needs to run without a frontend.
+   *
+   * Timers are derived from the executed cycles, so a machine behaves exactly the same on every run
+   * with the same seed and input.
+   *
+   * @tparam Quirks The quirk set of the processor.
+   */
+  template<QuirkSet Quirks>
+  class BasicMachine final {
+  public:
+    struct Snapshot final {
+      ProcessorState processor;
+      CallStack call_stack;
+      Memory memory;
+      FrameBuffer frame;
+      bool halted;
+    };
+
+    /**
+     * Create a machine with the default font loaded.
+     *
+     * @param quirks The quirks of the processor.
+     * @param logger The logger of the processor.
+     * @param seed The seed of the random number generator.
+     */
+    BasicMachine(Quirks const& quirks, Logger& logger, std::uint32_t const seed = 0u)
+        :processor_{quirks, call_stack_, memory_, screen_, audio_, logger}
+    {
+      processor_.seed(seed);
+      save_baseline();
+    }
+
+    BasicMachine(BasicMachine const&) = delete;
+
+    BasicMachine& operator=(BasicMachine const&) = delete;
+
+    /**
+     * Load a program to the start of the code section.
+     *
+     * @param rom The program.
+     * @throws MemoryOverflowException if the program does not fit in memory.
+     */
+    void load(std::span<std::uint8_t const> const rom)
+    {
+      memory_.load(BasicProcessor<Quirks>::CODE_START, rom);
+    }
+
+    /**
+     * Execute a single instruction and tick the timers when it is time to.
+     *
+     * @return true, if the instruction was executed, false if the processor ran into an error.
+     */
+    bool step()
+    {
+      if (!processor_.step())
+        halted_ = true;
+      if (processor_.cycles()%CYCLES_PER_TIMER_TICK==0u)
+        processor_.update_timers();
+      return !halted_;
+    }
+
+    /**
+     * Execute instructions until the given number of cycles has passed or the processor halts.
+     *
+     * @param cycles The maximum number of instructions to execute.
+     * @return The number of instructions executed, including the one halting the processor.
+     */
+    std::uint64_t advance(std::uint64_t const cycles)
+    {
+      auto const start = processor_.cycles();
+      auto const end = start+cycles;
+      while (processor_.cycles()<end && !halted_) {
+        auto const next_tick = (processor_.cycles()/CYCLES_PER_TIMER_TICK+1u)*CYCLES_PER_TIMER_TICK;
+        auto const result = processor_.run_until(std::min(end, next_tick));
+        if (result.reason!=StopReason::BudgetExhausted)
+          halted_ = true;
+        if (processor_.cycles()%CYCLES_PER_TIMER_TICK==0u)
+          processor_.update_timers();
+      }
+      return processor_.cycles()-start;
+    }
+
+    /**
+     * Check whether the processor ran into an error.
+     *
+     * @return true, if the machine stopped, false otherwise.
+     */
+    [[nodiscard]] bool halted() const noexcept
+    {
+      return halted_;
+    }
+
+    /**
+     * Hash the state of the machine.
+     *
+     * @return The hashes of processor, memory and screen.
+     */
+    [[nodiscard]] MachineDigest digest() const
+    {
+      // the top of the stack is enough, any other difference shows up as soon as the stack unwinds
+      auto processor = hash_combine(processor_.state().digest(), call_stack_.size());
+      if (auto const top = call_stack_.top(); top.has_value())
+        processor = hash_combine(processor, static_cast<std::uint16_t>(*top));
+      processor = hash_combine(processor, halted_);
+
+      auto const frame = screen_.frame();
+      auto screen = static_cast<std::uint64_t>(frame.high_resolution);
+      for (std::uint8_t y = 0; y<frame.height(); ++y)
+        screen = hash_combine(hash_combine(screen, frame.rows[y].high), frame.rows[y].low);
+
+      return MachineDigest{.processor = processor, .memory = memory_.digest(), .screen = screen};
+    }
+
+    [[nodiscard]] Snapshot snapshot() const
+    {
+      return Snapshot{
+          .processor = processor_.state(),
+          .call_stack = call_stack_,
+          .memory = memory_,
+          .frame = screen_.frame(),
+          .halted = halted_,
+      };
+    }
+
+    void restore(Snapshot const& snapshot)
+    {
+      processor_.restore(snapshot.processor);
+      call_stack_ = snapshot.call_stack;
+      memory_ = snapshot.memory;
+      screen_.restore(snapshot.frame);
+      halted_ = snapshot.halted;
+    }
+
+    /**
+     * Make the current state the one reset() returns to, usually right after loading a program.
+     */
+    void save_baseline()
+    {
+      memory_.mark_clean();
+      baseline_ = snapshot();
+    }
+
+    /**
+     * Return to the state saved by save_baseline(), or the initial state if there is none.
+     *
+     * Only the memory written to since then is restored, so resetting is a lot cheaper than creating a new machine.
+     */
+    void reset()
+    {
+      processor_.restore(baseline_.processor);
+      call_stack_ = baseline_.call_stack;
+      memory_.revert(baseline_.memory);
+      screen_.restore(baseline_.frame);
+      halted_ = baseline_.halted;
+    }
+
+    [[nodiscard]] BasicProcessor<Quirks>& processor() noexcept
+    {
+      return processor_;
+    }
+
+    [[nodiscard]] BasicProcessor<Quirks> const& processor() const noexcept
+    {
+      return processor_;
+    }
+
+    [[nodiscard]] Memory const& memory() const noexcept
+    {
+      return memory_;
+    }
+
+    [[nodiscard]] PackedScreen const& screen() const noexcept
+    {
+      return screen_;
+    }
+
+  private:
+    CallStack call_stack_{};
+    Memory memory_{};
+    PackedScreen screen_{};
+    NullAudio audio_{};
+    BasicProcessor<Quirks> processor_;
+    bool halted_{false};
+    Snapshot baseline_{};
+  };
+
+  using Machine = BasicMachine<Config>;
+}
+
+#endif // CHIP8_VM_MACHINE_HXX
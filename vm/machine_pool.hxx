@@ -0,0 +1,229 @@
+#pragma once
+
+#ifndef CHIP8_VM_MACHINE_POOL_HXX
+#define CHIP8_VM_MACHINE_POOL_HXX
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+
+#include "hash.hxx"
+#include "logger.hxx"
+#include "machine.hxx"
+
+namespace chip8 {
+  /**
+   * Machines created up front and handed out to sessions, so starting a session does not construct anything.
+   *
+   * The machines live in one array with every machine starting on its own cache line. Free machines are kept in a
+   * lock-free list, so any number of threads can acquire and release them at the same time. A released machine is
+   * reset like between fuzz inputs, restoring only the memory blocks the session wrote to. Every session gets its own
+   * seed, so sessions do not see the same random numbers.
+   *
+   * @tparam Quirks The quirk set of the processors.
+   */
+  template<QuirkSet Quirks>
+  class BasicMachinePool final {
+    struct alignas(64) Slot final {
+      std::optional<BasicMachine<Quirks>> machine{};
+      std::atomic<std::uint32_t> next{0u};
+    };
+
+  public:
+    /**
+     * A machine taken from the pool, which goes back to it when the lease is destroyed or released.
+     *
+     * The program is loaded on top of the state after construction, so reset() on the machine clears it as well.
+     * Sessions must not call save_baseline(), the pool relies on the baseline to clean up after them.
+     */
+    class Lease final {
+    public:
+      Lease(Lease&& other) noexcept
+          :pool_{std::exchange(other.pool_, nullptr)}, index_{other.index_}
+      {
+      }
+
+      Lease& operator=(Lease&& other) noexcept
+      {
+        if (this!=&other) {
+          release();
+          pool_ = std::exchange(other.pool_, nullptr);
+          index_ = other.index_;
+        }
+        return *this;
+      }
+
+      ~Lease() noexcept
+      {
+        release();
+      }
+
+      [[nodiscard]] BasicMachine<Quirks>& operator*() const noexcept
+      {
+        return *pool_->slots_[index_].machine;
+      }
+
+      [[nodiscard]] BasicMachine<Quirks>* operator->() const noexcept
+      {
+        return &**this;
+      }
+
+      /**
+       * Return the machine to the pool early. The lease must not be used afterwards.
+       */
+      void release() noexcept
+      {
+        if (pool_!=nullptr)
+          std::exchange(pool_, nullptr)->release(index_);
+      }
+
+    private:
+      friend class BasicMachinePool;
+
+      BasicMachinePool* pool_;
+      std::uint32_t index_;
+
+      Lease(BasicMachinePool* const pool, std::uint32_t const index) noexcept
+          :pool_{pool}, index_{index}
+      {
+      }
+    };
+
+    /**
+     * Create all machines of the pool.
+     *
+     * @param quirks The quirks of the processors.
+     * @param logger The logger of the processors, shared by all machines.
+     * @param capacity The number of machines.
+     * @param seed The seed the seeds of the sessions are derived from.
+     */
+    BasicMachinePool(Quirks const& quirks, Logger& logger, std::uint32_t const capacity, std::uint32_t const seed = 0u)
+        :slots_{std::make_unique<Slot[]>(capacity)}, capacity_{capacity}, seed_{seed}
+    {
+      for (std::uint32_t n = 0; n<capacity; ++n) {
+        slots_[n].machine.emplace(quirks, logger, seed);
+        slots_[n].next.store(n+1u<capacity ? n+1u : NONE, std::memory_order_relaxed);
+      }
+      free_.store(capacity>0u ? 0u : NONE, std::memory_order_release);
+    }
+
+    /**
+     * All leases must have been released before the pool is destroyed.
+     */
+    ~BasicMachinePool() noexcept = default;
+
+    BasicMachinePool(BasicMachinePool const&) = delete;
+
+    BasicMachinePool& operator=(BasicMachinePool const&) = delete;
+
+    /**
+     * Take a free machine and load a program into it, seeded differently from all sessions before.
+     *
+     * @param rom The program.
+     * @return The machine ready to run the program, or an empty optional if all machines are in use.
+     * @throws MemoryOverflowException if the program does not fit in memory.
+     */
+    [[nodiscard]] std::optional<Lease> acquire(std::span<std::uint8_t const> const rom)
+    {
+      auto const session = sessions_.fetch_add(1u, std::memory_order_relaxed);
+      return acquire(rom, static_cast<std::uint32_t>(mix64((std::uint64_t{seed_} << 32) ^ session)));
+    }
+
+    /**
+     * Take a free machine and load a program into it, e.g. to replay a session.
+     *
+     * @param rom The program.
+     * @param seed The seed of the random number generator.
+     * @return The machine ready to run the program, or an empty optional if all machines are in use.
+     * @throws MemoryOverflowException if the program does not fit in memory.
+     */
+    [[nodiscard]] std::optional<Lease> acquire(std::span<std::uint8_t const> const rom, std::uint32_t const seed)
+    {
+      auto const index = pop();
+      if (!index.has_value())
+        return std::nullopt;
+
+      try {
+        auto& machine = *slots_[*index].machine;
+        machine.processor().seed(seed);
+        machine.load(rom);
+      }
+      catch (...) {
+        push(*index);
+        throw;
+      }
+      return Lease{this, *index};
+    }
+
+    [[nodiscard]] std::uint32_t capacity() const noexcept
+    {
+      return capacity_;
+    }
+
+  private:
+    static std::uint32_t constexpr NONE = 0xFFFFFFFFu;
+
+    std::unique_ptr<Slot[]> slots_;
+    std::uint32_t capacity_;
+    std::uint32_t seed_;
+    std::atomic<std::uint64_t> sessions_{0u};
+    /**
+     * The index of the first free machine in the lower half, a counter against the ABA problem in the upper half.
+     */
+    alignas(64) std::atomic<std::uint64_t> free_{NONE};
+
+    static std::uint64_t tagged(std::uint32_t const index, std::uint64_t const previous) noexcept
+    {
+      return (((previous >> 32)+1u) << 32) | index;
+    }
+
+    std::optional<std::uint32_t> pop() noexcept
+    {
+      auto head = free_.load(std::memory_order_acquire);
+      while (true) {
+        auto const index = static_cast<std::uint32_t>(head);
+        if (index==NONE)
+          return std::nullopt;
+
+        auto const next = slots_[index].next.load(std::memory_order_relaxed);
+        if (free_.compare_exchange_weak(head, tagged(next, head), std::memory_order_acquire,
+            std::memory_order_acquire))
+          return index;
+      }
+    }
+
+    void push(std::uint32_t const index) noexcept
+    {
+      auto head = free_.load(std::memory_order_relaxed);
+      do {
+        slots_[index].next.store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+      }
+      while (!free_.compare_exchange_weak(head, tagged(index, head), std::memory_order_release,
+          std::memory_order_relaxed));
+    }
+
+    void release(std::uint32_t const index) noexcept
+    {
+      auto& machine = *slots_[index].machine;
+      machine.reset();
+
+      // nothing the session attached may outlive it
+      auto& processor = machine.processor();
+      processor.clear_breakpoints();
+      processor.set_tracer(nullptr);
+      processor.set_metrics(nullptr);
+      processor.set_latency_tracer(nullptr);
+      while (processor.applied_input()) {
+      }
+
+      push(index);
+    }
+  };
+
+  using MachinePool = BasicMachinePool<Config>;
+}
+
+#endif // CHIP8_VM_MACHINE_POOL_HXX
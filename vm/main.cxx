@@ -1,12 +1,25 @@
 #include <SDL.h>
 
+#include <beeper.hxx>
 #include <call_stack.hxx>
+#include <input_latency.hxx>
 #include <memory.hxx>
+#include <metrics.hxx>
+#include <packed_screen.hxx>
 #include <processor.hxx>
+#include <rom_store.hxx>
+#include <trace.hxx>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
-#include <fstream>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <span>
+#include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -41,116 +54,209 @@ class SdlLogger final : public chip8::Logger {
         message
     );
   }
-};
-
-class SdlScreen final : public chip8::Screen {
-public:
-  void clear() override
-  {
-    for (auto& line: pixels_) {
-      for (auto& pixel: line) {
-        pixel = false;
-      }
-    }
-    needs_redraw_ = true;
-  }
 
-  bool get_pixel(std::uint8_t const x, std::uint8_t const y) override
+  [[nodiscard]] bool debug_enabled() const noexcept override
   {
-    return pixels_[y][x];
-  }
-
-  void set_pixel(std::uint8_t const x, std::uint8_t const y, bool const state) override
-  {
-    pixels_[y][x] = state;
-    needs_redraw_ = true;
+    return SDL_LogGetPriority(SDL_LOG_CATEGORY_APPLICATION)<=SDL_LOG_PRIORITY_DEBUG;
   }
+};
 
-  void draw_to(SDL_Renderer* renderer)
+/**
+ * Screen drawn by the processor thread and presented by the UI thread.
+ *
+ * Only the latest frame is presented, frames drawn in between are skipped.
+ */
+class SdlScreen final : public chip8::PackedScreen {
+public:
+  /**
+   * Render the frame, if it changed since it was last rendered.
+   *
+   * @return true, if a frame was rendered.
+   */
+  bool draw_to(SDL_Renderer* renderer)
   {
-    if (!needs_redraw_)
-      return;
-    needs_redraw_ = false;
+    auto const version = this->version();
+    if (version==drawn_version_)
+      return false;
+    drawn_version_ = version;
 
-    std::array<SDL_Rect, Screen::WIDTH*Screen::HEIGHT> points{};
+    auto const frame = this->frame();
+    // the window fits the high resolution, pixels of the low resolution are twice as big
+    auto const size = frame.high_resolution ? 10 : 20;
     int num_points = 0;
-    for (auto y = Screen::HEIGHT; y--;) {
-      for (auto x = Screen::WIDTH; x--;) {
-        if (get_pixel(x, y))
-          points[num_points++] = SDL_Rect{x*20, y*20, 20, 20};
+    for (std::uint8_t y = 0; y<frame.height(); ++y) {
+      for (std::uint8_t x = 0; x<frame.width(); ++x) {
+        if (frame.pixel(x, y))
+          points_[num_points++] = SDL_Rect{x*size, y*size, size, size};
       }
     }
 
     SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, SDL_ALPHA_OPAQUE);
     SDL_RenderClear(renderer);
     SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, SDL_ALPHA_OPAQUE);
-    SDL_RenderFillRects(renderer, points.data(), num_points);
+    SDL_RenderFillRects(renderer, points_.data(), num_points);
     SDL_RenderPresent(renderer);
+    return true;
   }
 
 private:
-  std::array<std::array<bool, WIDTH>, HEIGHT> pixels_{};
-  bool needs_redraw_{true};
+  std::uint64_t drawn_version_{~std::uint64_t{0u}};
+  std::vector<SDL_Rect> points_ = std::vector<SDL_Rect>(Screen::HIRES_WIDTH*Screen::HIRES_HEIGHT);
 };
 
-int main(int argc, char** argv)
-{
-  if (argc<2) {
-    SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Missing argument", "Usage: ./chip_8 [rom] {delay-in-ms=1000}",
-        nullptr);
-    return 0;
-  }
-
-  auto const delay = argc>2 ? std::stoi(argv[2]) : 1000;
-  bool show_debug_log = false;
+using namespace std::chrono_literals;
 
-  std::ifstream rom{argv[1], std::ios::binary | std::ios::ate};
-  auto const size = rom.tellg();
-  rom.seekg(std::ios::beg);
-  std::vector<std::uint8_t> content(size);
-  rom.read(reinterpret_cast<char*>(content.data()), size);
+/**
+ * The processor runs in batches of this many cycles, between which speed changes are picked up.
+ */
+auto constexpr BATCH_CYCLES = chip8::CYCLES_PER_SECOND/1000u;
+/**
+ * When the processor falls behind by more than this, it continues from the current time instead of catching up.
+ */
+auto constexpr MAX_LAG = 50ms;
+/**
+ * Returned by SDL_RegisterEvents when no more user events are available.
+ */
+auto constexpr INVALID_EVENT = static_cast<std::uint32_t>(-1);
+int constexpr SAMPLE_RATE = 48'000;
 
-  SDL_Init(SDL_INIT_EVERYTHING);
-  SDL_Window* window = SDL_CreateWindow("CHIP-8", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 640, 0u);
-  SDL_Renderer* renderer = SDL_CreateRenderer(window, 0, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+struct Options final {
+  std::vector<char const*> positional{};
+  std::optional<std::filesystem::path> trace{};
+  std::optional<std::filesystem::path> metrics{};
+  bool trace_latency{false};
+  /**
+   * Empty to detect the profile from the ROM.
+   */
+  std::optional<chip8::QuirkProfile> quirks{chip8::QuirkProfile::Cosmac};
+  std::uint16_t audio_buffer{128u};
+  /**
+   * Speed multiplier, 0 runs as fast as possible.
+   */
+  unsigned speed{1u};
+  /**
+   * Speed multiplier while the turbo key is held, 0 runs as fast as possible.
+   */
+  unsigned turbo{10u};
+};
 
-  SdlScreen screen;
-  SdlLogger logger;
-  chip8::CallStack call_stack;
-  chip8::Memory memory;
-  memory.load(chip8::Processor::CODE_START, content);
-  chip8::Config const config = {
-      .register_rw_modifies_i = true,
-      .shift_takes_value_from_vy = true,
-      .use_vx_for_offset_jump = false,
-  };
-  chip8::Processor processor{config, call_stack, memory, screen, logger};
+Options parse_options(int const argc, char** argv)
+{
+  Options options{};
+  for (int n = 1; n<argc; ++n) {
+    std::string_view const arg{argv[n]};
+    if (arg.starts_with("--trace="))
+      options.trace = arg.substr(8);
+    else if (arg.starts_with("--metrics="))
+      options.metrics = arg.substr(10);
+    else if (arg=="--trace-latency")
+      options.trace_latency = true;
+    else if (arg=="--speed=max")
+      options.speed = 0u;
+    else if (arg.starts_with("--speed="))
+      options.speed = static_cast<unsigned>(std::stoul(std::string{arg.substr(8)}));
+    else if (arg=="--turbo=max")
+      options.turbo = 0u;
+    else if (arg.starts_with("--turbo="))
+      options.turbo = static_cast<unsigned>(std::stoul(std::string{arg.substr(8)}));
+    else if (arg.starts_with("--audio-buffer="))
+      options.audio_buffer = static_cast<std::uint16_t>(std::stoi(std::string{arg.substr(15)}));
+    else if (arg=="--quirks=chip48")
+      options.quirks = chip8::QuirkProfile::Chip48;
+    else if (arg=="--quirks=schip")
+      options.quirks = chip8::QuirkProfile::SuperChip;
+    else if (arg=="--quirks=cosmac")
+      options.quirks = chip8::QuirkProfile::Cosmac;
+    else if (arg=="--quirks=auto")
+      options.quirks.reset();
+    else
+      options.positional.push_back(argv[n]);
+  }
+  return options;
+}
 
-  auto const timer_updater = SDL_AddTimer(delay, [](std::uint32_t const interval, void* ctx) -> std::uint32_t {
-    auto const processor = reinterpret_cast<chip8::Processor*>(ctx);
-    processor->update_timers();
-    return interval;
-  }, &processor);
+/**
+ * Show the achieved speed relative to the original hardware in the window title.
+ */
+void show_speed(SDL_Window* window, double const speed)
+{
+  auto const title = "CHIP-8 - " + std::to_string(static_cast<int>(speed*100.0+0.5)) + "%";
+  SDL_SetWindowTitle(window, title.c_str());
+}
 
+/**
+ * Run the processor on its own thread while the calling thread handles input and presents frames.
+ *
+ * Timers are derived from the executed cycles, so they scale with the speed of the processor.
+ */
+template<typename Processor>
+void run_session(Processor& processor, SdlScreen& screen, SDL_Window* window, SDL_Renderer* renderer,
+    chip8::Beeper* beeper, std::uint64_t const timer_period, chip8::EmulatorMetrics* metrics,
+    chip8::InputLatencyTracer* latency, Options const& options)
+{
+  bool show_debug_log = false;
   std::atomic<bool> run = true;
+  std::atomic<unsigned> speed = options.speed;
+  // published by the processor thread after every batch, so the UI thread can measure the speed
+  std::atomic<std::uint64_t> executed = 0u;
 
-  std::thread vm_thread{[&run, &processor] {
-    using namespace std::chrono_literals;
-    auto const intended = 1'428ns; // '000ns; // ~700Hz
+  // the processor thread wakes the UI thread with this event when the frame changed or the processor stopped,
+  // there is at most one of them queued at any time
+  auto const frame_event = SDL_RegisterEvents(1);
+  std::atomic<bool> frame_pending = false;
+  auto const notify = [&] {
+    if (frame_event==INVALID_EVENT || frame_pending.exchange(true))
+      return;
+    SDL_Event evt{};
+    evt.type = frame_event;
+    SDL_PushEvent(&evt);
+  };
 
-    auto start = std::chrono::high_resolution_clock::now();
+  std::thread vm_thread{[&] {
+    auto next = std::chrono::steady_clock::now();
+    auto notified_version = screen.version();
+    // the beeper starts at normal speed
+    auto beeper_speed = 1u;
     while (run) {
-      auto const end = std::chrono::high_resolution_clock::now();
-      auto const elapsed = end-start;
-      auto const diff = intended-elapsed;
-      if (diff.count()>0) {
-        std::this_thread::sleep_for(diff);
+      auto const multiplier = speed.load(std::memory_order_relaxed);
+      if (beeper!=nullptr && multiplier!=beeper_speed) {
+        beeper->set_speed(multiplier, processor.cycles());
+        beeper_speed = multiplier;
       }
-      start = std::chrono::high_resolution_clock::now();
 
-      if (!processor.step())
-        run = false;
+      auto const end = processor.cycles()+BATCH_CYCLES;
+      while (run && processor.cycles()<end) {
+        auto const next_tick = (processor.cycles()/timer_period+1u)*timer_period;
+        auto const result = processor.run_until(std::min(end, next_tick));
+        if (result.reason!=chip8::StopReason::BudgetExhausted)
+          run = false;
+        if (metrics!=nullptr)
+          metrics->instructions.add(result.cycles);
+        if (processor.cycles()%timer_period==0u) {
+          processor.update_timers();
+          if (metrics!=nullptr)
+            metrics->frames.add();
+        }
+      }
+      executed.store(processor.cycles(), std::memory_order_relaxed);
+      if (auto const version = screen.version(); version!=notified_version) {
+        notified_version = version;
+        notify();
+      }
+
+      auto const now = std::chrono::steady_clock::now();
+      if (multiplier==0u || now-next>MAX_LAG) {
+        next = now;
+        continue;
+      }
+      next += chip8::INSTRUCTION_TIME*BATCH_CYCLES/multiplier;
+      if (metrics!=nullptr)
+        metrics->timer_drift.set(now-next);
+      std::this_thread::sleep_until(next);
+      if (metrics!=nullptr)
+        metrics->sleep_overshoot.observe(std::chrono::steady_clock::now()-next);
     }
+    notify();
   }};
 
   auto const toggle_key = [&processor](SDL_Scancode const scancode, bool pressed) {
@@ -208,32 +314,194 @@ int main(int argc, char** argv)
     }
   };
 
-  while (run) {
-    SDL_Event evt;
-    while (SDL_PollEvent(&evt)) {
-      if (evt.type==SDL_QUIT)
-        run = false;
-      else if (evt.type==SDL_KEYDOWN) {
+  auto const handle_event = [&](SDL_Event const& evt) {
+    if (evt.type==SDL_QUIT)
+      run = false;
+    else if (evt.type==frame_event)
+      frame_pending = false;
+    else if (evt.type==SDL_KEYDOWN) {
+      if (evt.key.keysym.scancode==SDL_SCANCODE_TAB)
+        speed = options.turbo;
+      else
         toggle_key(evt.key.keysym.scancode, true);
+    }
+    else if (evt.type==SDL_KEYUP) {
+      if (evt.key.keysym.scancode==SDL_SCANCODE_TAB)
+        speed = options.speed;
+      else if (evt.key.keysym.scancode==SDL_SCANCODE_L) {
+        show_debug_log = !show_debug_log;
+        SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION,
+            show_debug_log ? SDL_LOG_PRIORITY_DEBUG : SDL_LOG_PRIORITY_INFO);
       }
-      else if (evt.type==SDL_KEYUP) {
-        if (evt.key.keysym.scancode==SDL_SCANCODE_L) {
-          show_debug_log = !show_debug_log;
-          SDL_LogSetPriority(SDL_LOG_CATEGORY_APPLICATION,
-              show_debug_log ? SDL_LOG_PRIORITY_DEBUG : SDL_LOG_PRIORITY_INFO);
-        }
-        else {
-          toggle_key(evt.key.keysym.scancode, false);
-        }
+      else {
+        toggle_key(evt.key.keysym.scancode, false);
       }
     }
+  };
+
+  auto measured_at = std::chrono::steady_clock::now();
+  auto measured_cycles = executed.load(std::memory_order_relaxed);
 
-    screen.draw_to(renderer);
+  while (run) {
+    // sleep until there is input or a new frame, but wake up for the speed display
+    auto const until_measurement = std::chrono::ceil<std::chrono::milliseconds>(
+        measured_at+1s-std::chrono::steady_clock::now());
+    auto timeout = std::clamp<int>(static_cast<int>(until_measurement.count()), 0, 1000);
+    if (frame_event==INVALID_EVENT)
+      timeout = std::min(timeout, 4);
+
+    SDL_Event evt;
+    if (SDL_WaitEventTimeout(&evt, timeout)) {
+      handle_event(evt);
+      while (SDL_PollEvent(&evt))
+        handle_event(evt);
+    }
+
+    // presenting waits for the display refresh, frames drawn in the meantime are skipped
+    auto const render_started = std::chrono::steady_clock::now();
+    if (screen.draw_to(renderer)) {
+      auto const presented_at = std::chrono::steady_clock::now();
+      if (metrics!=nullptr)
+        metrics->render.observe(presented_at-render_started);
+      if (latency!=nullptr)
+        latency->presented(render_started, presented_at);
+    }
+
+    auto const now = std::chrono::steady_clock::now();
+    if (now-measured_at>=1s) {
+      auto const cycles = executed.load(std::memory_order_relaxed);
+      auto const elapsed = std::chrono::duration<double>(now-measured_at).count();
+      show_speed(window, static_cast<double>(cycles-measured_cycles)/(elapsed*chip8::CYCLES_PER_SECOND));
+      measured_at = now;
+      measured_cycles = cycles;
+    }
   }
 
   vm_thread.join();
+}
+
+int main(int argc, char** argv)
+{
+  auto const options = parse_options(argc, argv);
+  if (options.positional.empty()) {
+    SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Missing argument",
+        "Usage: ./chip_8 [rom] {timer-interval-in-ms} {--quirks=cosmac|chip48|schip|auto} "
+        "{--speed=multiplier|max} {--turbo=multiplier|max} {--audio-buffer=samples} {--trace=file} "
+        "{--metrics=file} {--trace-latency}", nullptr);
+    return 0;
+  }
+
+  // the timers tick at 60 Hz like in the headless frontend and Machine, unless another interval is given
+  auto timer_period = chip8::CYCLES_PER_TIMER_TICK;
+  if (options.positional.size()>1) {
+    auto const delay = static_cast<unsigned>(std::stoi(options.positional[1]));
+    timer_period = std::max<std::uint64_t>(chip8::CYCLES_PER_SECOND*delay/1000u, 1u);
+  }
+
+  std::unique_ptr<chip8::TraceWriter> tracer{};
+  if (options.trace.has_value()) {
+    try {
+      tracer = std::make_unique<chip8::TraceWriter>(*options.trace);
+    }
+    catch (chip8::TraceException const& ex) {
+      SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Tracing failed", ex.what(), nullptr);
+      return 1;
+    }
+  }
+
+  chip8::RomStore roms;
+  std::shared_ptr<chip8::Rom const> rom{};
+  try {
+    rom = roms.open(options.positional[0]);
+  }
+  catch (chip8::RomException const& ex) {
+    SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Loading ROM failed", ex.what(), nullptr);
+    return 1;
+  }
+
+  // the metrics are only registered and updated when they are exported
+  chip8::MetricsRegistry registry;
+  std::optional<chip8::EmulatorMetrics> metrics{};
+  std::unique_ptr<chip8::MetricsFileExporter> exporter{};
+  if (options.metrics.has_value()) {
+    metrics.emplace(registry);
+    try {
+      exporter = std::make_unique<chip8::MetricsFileExporter>(registry, *options.metrics);
+    }
+    catch (chip8::MetricsException const& ex) {
+      SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Exporting metrics failed", ex.what(), nullptr);
+      return 1;
+    }
+  }
+  auto* const emulator_metrics = metrics.has_value() ? &*metrics : nullptr;
+
+  SDL_Init(SDL_INIT_EVERYTHING);
+  SDL_Window* window = SDL_CreateWindow("CHIP-8", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1280, 640, 0u);
+  SDL_Renderer* renderer = SDL_CreateRenderer(window, 0, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+
+  chip8::Beeper beeper{chip8::CYCLES_PER_SECOND};
+  chip8::NullAudio null_audio;
+  SDL_AudioSpec const wanted_audio{
+      .freq = SAMPLE_RATE,
+      .format = AUDIO_S16SYS,
+      .channels = 1,
+      .samples = options.audio_buffer,
+      .callback = [](void* ctx, std::uint8_t* stream, int const length) {
+        auto const samples = reinterpret_cast<std::int16_t*>(stream);
+        static_cast<chip8::Beeper*>(ctx)->render(
+            std::span{samples, static_cast<std::size_t>(length)/sizeof(std::int16_t)});
+      },
+      .userdata = &beeper,
+  };
+  SDL_AudioSpec audio_spec{};
+  auto const audio_device = SDL_OpenAudioDevice(nullptr, 0, &wanted_audio, &audio_spec, 0);
+  if (audio_device!=0) {
+    beeper.set_output_format(audio_spec.freq, audio_spec.samples);
+    SDL_PauseAudioDevice(audio_device, 0);
+  }
+  else {
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Could not open audio device: %s", SDL_GetError());
+  }
+  chip8::Audio& audio = audio_device!=0 ? static_cast<chip8::Audio&>(beeper) : null_audio;
+
+  SdlScreen screen;
+  SdlLogger logger;
+  chip8::CallStack call_stack;
+  chip8::Memory memory;
+  memory.load(chip8::Processor::CODE_START, rom->bytes());
+
+  std::optional<chip8::InputLatencyTracer> latency{};
+  if (options.trace_latency)
+    latency.emplace();
+  auto* const latency_tracer = latency.has_value() ? &*latency : nullptr;
+
+  auto const quirks = options.quirks.value_or(rom->quirk_profile());
+  chip8::with_quirk_profile(quirks, [&]<typename Quirks>(std::type_identity<Quirks>) {
+    chip8::BasicProcessor<Quirks> processor{Quirks{}, call_stack, memory, screen, audio, logger};
+    processor.set_tracer(tracer.get());
+    processor.set_metrics(emulator_metrics);
+    processor.set_latency_tracer(latency_tracer);
+    run_session(processor, screen, window, renderer, audio_device!=0 ? &beeper : nullptr, timer_period,
+        emulator_metrics, latency_tracer, options);
+  });
+
+  if (latency.has_value()) {
+    std::ostringstream report{};
+    latency->report(report);
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "%s", report.str().c_str());
+  }
+
+  if (tracer) {
+    try {
+      tracer->close();
+    }
+    catch (chip8::TraceException const& ex) {
+      SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", ex.what());
+    }
+  }
 
-  SDL_RemoveTimer(timer_updater);
+  if (audio_device!=0)
+    SDL_CloseAudioDevice(audio_device);
 
   SDL_DestroyRenderer(renderer);
   SDL_DestroyWindow(window);
@@ -5,11 +5,13 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cstdint>
 #include <ranges>
 #include <stdexcept>
 
 #include "address.hxx"
+#include "hash.hxx"
 
 namespace chip8 {
   /**
@@ -23,24 +25,69 @@ namespace chip8 {
     using std::runtime_error::operator=;
   };
 
-  class Memory final {
+  /**
+   * The memory of a CHIP-8 variant, covering its whole address space.
+   *
+   * @tparam AddressType The address type of the variant, which determines the size of the memory.
+   */
+  template<typename AddressType>
+  class BasicMemory final {
   public:
+    static std::size_t constexpr SIZE = std::size_t{AddressType::VALUE_MASK}+1u;
+    /**
+     * Granularity at which writes are tracked for revert().
+     */
+    static std::size_t constexpr BLOCK_SIZE = 64u;
+
     /**
      * The default constructor.
      *
      * The memory is initially filled with zeroes.
      */
-    Memory() noexcept;
+    BasicMemory() noexcept;
 
-    Memory(Memory const&) noexcept = default;
+    BasicMemory(BasicMemory const&) noexcept = default;
 
-    Memory& operator=(Memory const&) noexcept = default;
+    BasicMemory& operator=(BasicMemory const&) noexcept = default;
 
-    std::uint8_t operator[](Address address) const noexcept;
+    std::uint8_t operator[](AddressType const address) const noexcept
+    {
+      // every instruction fetch goes through here, so it is defined inline
+      return memory_[static_cast<std::uint16_t>(address)];
+    }
 
-    std::uint8_t& operator[](Address address) noexcept;
+    /**
+     * Write a single byte.
+     *
+     * @param address The address to write to.
+     * @param value The value to be written.
+     */
+    void write(AddressType address, std::uint8_t value) noexcept;
 
-    void load_default_font(Address const base) noexcept;
+    void load_default_font(AddressType const base) noexcept;
+
+    /**
+     * Get a hash of the whole memory.
+     *
+     * The hash is computed once after loading data and then kept up to date by every write, so getting it is cheap.
+     *
+     * @return The hash of the memory contents.
+     */
+    [[nodiscard]] std::uint64_t digest() const noexcept;
+
+    /**
+     * Make the current contents the baseline for revert().
+     */
+    void mark_clean() noexcept;
+
+    /**
+     * Undo all writes since the last call to mark_clean().
+     *
+     * Only the blocks written to since then are copied back, which makes this much cheaper than copying everything.
+     *
+     * @param baseline Memory with the contents at the time mark_clean() was called.
+     */
+    void revert(BasicMemory const& baseline) noexcept;
 
     /**
      * Load data from the given source.
@@ -50,20 +97,58 @@ namespace chip8 {
      * @param source The source data to be loaded.
      */
     template<std::ranges::sized_range Source>
-    void load(Address const base, Source&& source)
+    void load(AddressType const base, Source&& source)
     {
       auto const offset = static_cast<std::uint16_t>(base);
-      auto const max_len = 0x1000u-offset;
+      auto const max_len = SIZE-offset;
       auto const len = std::ranges::size(std::forward<Source>(source));
       if (len>max_len)
         throw MemoryOverflowException{"Trying to load more data than fits in memory"};
 
+      if (len==0u)
+        return;
+
       std::ranges::copy(std::forward<Source>(source), std::ranges::begin(memory_)+offset);
+      mark_dirty(offset, len);
+      digest_valid_ = false;
     }
 
   private:
-    std::array<std::uint8_t, 4096u> memory_;
+    static std::size_t constexpr BLOCKS_PER_WORD = 64u;
+
+    std::array<std::uint8_t, SIZE> memory_;
+    mutable std::uint64_t digest_{0u};
+    mutable bool digest_valid_{true};
+    /**
+     * One bit per block written to since the last call to mark_clean().
+     */
+    std::array<std::uint64_t, SIZE/BLOCK_SIZE/BLOCKS_PER_WORD> dirty_{};
+
+    void mark_dirty(std::size_t offset, std::size_t length) noexcept;
+
+    /**
+     * The contribution of a single byte to the digest.
+     *
+     * Zero bytes do not contribute, so the digest of empty memory is zero.
+     */
+    static constexpr std::uint64_t digest_of(std::uint16_t const address, std::uint8_t const value) noexcept
+    {
+      return value==0u ? 0u : mix64((static_cast<std::uint64_t>(address) << 8) | value);
+    }
   };
+
+  /**
+   * The 4kiB memory of CHIP-8 and SUPER-CHIP.
+   */
+  using Memory = BasicMemory<Address>;
+
+  /**
+   * The 64kiB memory of XO-CHIP.
+   */
+  using ExtendedMemory = BasicMemory<LongAddress>;
+
+  extern template class BasicMemory<Address>;
+  extern template class BasicMemory<LongAddress>;
 }
 
 #endif // CHIP8_VM_MEMORY_HXX
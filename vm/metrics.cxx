@@ -0,0 +1,160 @@
+#include "metrics.hxx"
+
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include <type_traits>
+
+namespace chip8 {
+  namespace {
+    std::atomic<std::size_t> next_shard{0u};
+
+    double seconds(std::chrono::nanoseconds const duration) noexcept
+    {
+      return std::chrono::duration<double>(duration).count();
+    }
+  }
+
+  std::size_t metric_shard() noexcept
+  {
+    thread_local std::size_t const shard = next_shard.fetch_add(1u, std::memory_order_relaxed)%METRIC_SHARDS;
+    return shard;
+  }
+
+  std::uint64_t Counter::value() const noexcept
+  {
+    std::uint64_t sum = 0u;
+    for (auto const& shard: shards_)
+      sum += shard.value.load(std::memory_order_relaxed);
+    return sum;
+  }
+
+  Histogram::Snapshot Histogram::snapshot() const noexcept
+  {
+    Snapshot result{};
+    std::uint64_t sum = 0u;
+    for (auto const& shard: shards_) {
+      for (std::size_t n = 0; n<BUCKETS; ++n)
+        result.buckets[n] += shard.buckets[n].load(std::memory_order_relaxed);
+      sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    for (auto const count: result.buckets)
+      result.count += count;
+    result.sum = std::chrono::nanoseconds{static_cast<std::int64_t>(sum)};
+    return result;
+  }
+
+  Counter& MetricsRegistry::counter(std::string name, std::string help)
+  {
+    std::lock_guard const lock{mutex_};
+    return std::get<Counter>(entries_.emplace_back(std::move(name), std::move(help),
+        std::in_place_type<Counter>).metric);
+  }
+
+  Gauge& MetricsRegistry::gauge(std::string name, std::string help)
+  {
+    std::lock_guard const lock{mutex_};
+    return std::get<Gauge>(entries_.emplace_back(std::move(name), std::move(help),
+        std::in_place_type<Gauge>).metric);
+  }
+
+  Histogram& MetricsRegistry::histogram(std::string name, std::string help)
+  {
+    std::lock_guard const lock{mutex_};
+    return std::get<Histogram>(entries_.emplace_back(std::move(name), std::move(help),
+        std::in_place_type<Histogram>).metric);
+  }
+
+  void MetricsRegistry::write(std::ostream& out) const
+  {
+    std::lock_guard const lock{mutex_};
+    for (auto const& entry: entries_) {
+      out << "# HELP " << entry.name << ' ' << entry.help << '\n';
+      std::visit([&out, &name = entry.name]<typename Metric>(Metric const& metric) {
+        if constexpr (std::is_same_v<Metric, Counter>) {
+          out << "# TYPE " << name << " counter\n"
+              << name << ' ' << metric.value() << '\n';
+        }
+        else if constexpr (std::is_same_v<Metric, Gauge>) {
+          out << "# TYPE " << name << " gauge\n"
+              << name << ' ' << seconds(metric.value()) << '\n';
+        }
+        else {
+          auto const snapshot = metric.snapshot();
+          out << "# TYPE " << name << " histogram\n";
+          // buckets are cumulative in the exposition format
+          std::uint64_t cumulative = 0u;
+          for (std::size_t n = 0; n<Histogram::BUCKETS-1u; ++n) {
+            cumulative += snapshot.buckets[n];
+            out << name << "_bucket{le=\"" << seconds(std::chrono::nanoseconds{Histogram::upper_bound(n)})
+                << "\"} " << cumulative << '\n';
+          }
+          out << name << "_bucket{le=\"+Inf\"} " << snapshot.count << '\n'
+              << name << "_sum " << seconds(snapshot.sum) << '\n'
+              << name << "_count " << snapshot.count << '\n';
+        }
+      }, entry.metric);
+    }
+  }
+
+  std::string MetricsRegistry::text() const
+  {
+    std::ostringstream out{};
+    write(out);
+    return out.str();
+  }
+
+  EmulatorMetrics::EmulatorMetrics(MetricsRegistry& registry)
+      :instructions{registry.counter("chip8_instructions_total", "Instructions executed by the processor.")},
+       frames{registry.counter("chip8_frames_total", "Timer ticks, each completing a frame.")},
+       sleep_overshoot{registry.histogram("chip8_sleep_overshoot_seconds",
+           "Time the processor thread slept longer than requested.")},
+       draw{registry.histogram("chip8_draw_duration_seconds", "Time spent drawing sprites.")},
+       render{registry.histogram("chip8_render_duration_seconds", "Time the frontend took to render a frame.")},
+       timer_drift{registry.gauge("chip8_timer_drift_seconds",
+           "How far the timer ticks are behind the wall clock, negative while ahead.")}
+  {
+  }
+
+  MetricsFileExporter::MetricsFileExporter(MetricsRegistry const& registry, std::filesystem::path path,
+      std::chrono::milliseconds const interval)
+      :registry_{registry}, path_{std::move(path)}, interval_{interval}
+  {
+    if (!write())
+      throw MetricsException{"Could not write metrics file"};
+
+    thread_ = std::thread{[this] {
+      std::unique_lock lock{mutex_};
+      while (!stop_requested_.wait_for(lock, interval_, [this] { return stop_; }))
+        write();
+    }};
+  }
+
+  MetricsFileExporter::~MetricsFileExporter() noexcept
+  {
+    {
+      std::lock_guard const lock{mutex_};
+      stop_ = true;
+    }
+    stop_requested_.notify_one();
+    thread_.join();
+    write();
+  }
+
+  bool MetricsFileExporter::write() const
+  {
+    auto temporary = path_;
+    temporary += ".tmp";
+    {
+      std::ofstream file{temporary, std::ios::trunc};
+      registry_.write(file);
+      file.close();
+      if (file.fail())
+        return false;
+    }
+
+    std::error_code error{};
+    std::filesystem::rename(temporary, path_, error);
+    return !error;
+  }
+}
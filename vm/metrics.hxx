@@ -0,0 +1,264 @@
+#pragma once
+
+#ifndef CHIP8_VM_METRICS_HXX
+#define CHIP8_VM_METRICS_HXX
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+
+namespace chip8 {
+  /**
+   * Exception class being thrown when metrics cannot be exported.
+   *
+   * Even though the class has the same functionality as its base,
+   * it exists for improved readability as it is more specific.
+   */
+  class MetricsException final : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+    using std::runtime_error::operator=;
+  };
+
+  /**
+   * Number of slots every counter and histogram is split into, threads update the slot they were assigned to.
+   */
+  std::size_t constexpr METRIC_SHARDS = 8u;
+
+  /**
+   * Get the slot of the calling thread. Threads are assigned slots round robin on their first update.
+   *
+   * @return The index of the slot.
+   */
+  std::size_t metric_shard() noexcept;
+
+  /**
+   * A value which only ever grows, e.g. the number of executed instructions.
+   *
+   * Updates are relaxed atomic additions to the cache line of the calling thread's slot.
+   * Threads only contend when more than METRIC_SHARDS of them update the counter and share a slot.
+   */
+  class Counter final {
+  public:
+    void add(std::uint64_t const value = 1u) noexcept
+    {
+      shards_[metric_shard()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::uint64_t value() const noexcept;
+
+  private:
+    struct alignas(64) Shard final {
+      std::atomic<std::uint64_t> value{0u};
+    };
+
+    std::array<Shard, METRIC_SHARDS> shards_{};
+  };
+
+  /**
+   * A duration which can go up and down, set by a single thread.
+   */
+  class Gauge final {
+  public:
+    void set(std::chrono::nanoseconds const value) noexcept
+    {
+      value_.store(value.count(), std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::chrono::nanoseconds value() const noexcept
+    {
+      return std::chrono::nanoseconds{value_.load(std::memory_order_relaxed)};
+    }
+
+  private:
+    std::atomic<std::int64_t> value_{0};
+  };
+
+  /**
+   * Distribution of durations, counted into buckets growing by a factor of 4 from 64ns to 67ms.
+   *
+   * Observations are split into slots like counter updates, with the same contention.
+   */
+  class Histogram final {
+  public:
+    static std::size_t constexpr BUCKETS = 12u;
+
+    /**
+     * Get the inclusive upper bound of a bucket, the last one has no bound.
+     *
+     * @param bucket The index of the bucket, less than BUCKETS-1.
+     * @return The upper bound in nanoseconds.
+     */
+    static constexpr std::uint64_t upper_bound(std::size_t const bucket) noexcept
+    {
+      return std::uint64_t{64u} << (2u*bucket);
+    }
+
+    void observe(std::chrono::nanoseconds const duration) noexcept
+    {
+      auto const value = static_cast<std::uint64_t>(std::max<std::int64_t>(duration.count(), 0));
+      // ceil(log2(value)) picks the bucket directly, 64ns and below share the first one
+      auto const bits = static_cast<std::size_t>(std::bit_width(value>0u ? value-1u : 0u));
+      auto const bucket = bits<=6u ? 0u : std::min((bits-5u)/2u, BUCKETS-1u);
+
+      auto& shard = shards_[metric_shard()];
+      shard.buckets[bucket].fetch_add(1u, std::memory_order_relaxed);
+      shard.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    struct Snapshot final {
+      /**
+       * Number of observations per bucket, not cumulative.
+       */
+      std::array<std::uint64_t, BUCKETS> buckets{};
+      std::uint64_t count{0u};
+      std::chrono::nanoseconds sum{0};
+    };
+
+    [[nodiscard]] Snapshot snapshot() const noexcept;
+
+  private:
+    struct alignas(64) Shard final {
+      std::array<std::atomic<std::uint64_t>, BUCKETS> buckets{};
+      std::atomic<std::uint64_t> sum{0u};
+    };
+
+    std::array<Shard, METRIC_SHARDS> shards_{};
+  };
+
+  /**
+   * Owns named metrics and renders them in the Prometheus text format.
+   *
+   * Metrics are registered up front, updating them afterwards does not involve the registry.
+   * Durations are recorded in nanoseconds and exported in seconds.
+   */
+  class MetricsRegistry final {
+  public:
+    MetricsRegistry() = default;
+
+    MetricsRegistry(MetricsRegistry const&) = delete;
+
+    MetricsRegistry& operator=(MetricsRegistry const&) = delete;
+
+    /**
+     * Register a metric. The returned reference stays valid for the lifetime of the registry.
+     *
+     * @param name The name of the metric, e.g. chip8_instructions_total.
+     * @param help A description of the metric.
+     * @return The new metric.
+     */
+    Counter& counter(std::string name, std::string help);
+
+    Gauge& gauge(std::string name, std::string help);
+
+    Histogram& histogram(std::string name, std::string help);
+
+    /**
+     * Write the current values of all metrics in the Prometheus text exposition format.
+     *
+     * @param out The stream to write to.
+     */
+    void write(std::ostream& out) const;
+
+    [[nodiscard]] std::string text() const;
+
+  private:
+    struct Entry final {
+      template<typename Metric>
+      Entry(std::string name, std::string help, std::in_place_type_t<Metric> const type)
+          :name{std::move(name)}, help{std::move(help)}, metric{type}
+      {
+      }
+
+      std::string name;
+      std::string help;
+      std::variant<Counter, Gauge, Histogram> metric;
+    };
+
+    mutable std::mutex mutex_{};
+    // a deque never moves its elements, so references to metrics stay valid
+    std::deque<Entry> entries_{};
+  };
+
+  /**
+   * The metrics the frontends and the processor report.
+   */
+  struct EmulatorMetrics final {
+    explicit EmulatorMetrics(MetricsRegistry& registry);
+
+    Counter& instructions;
+    /**
+     * Timer ticks, which is when the frontends consider a frame done.
+     */
+    Counter& frames;
+    /**
+     * How much later than requested the processor thread woke up from sleeping.
+     */
+    Histogram& sleep_overshoot;
+    /**
+     * Time the processor spent in Dxyn.
+     */
+    Histogram& draw;
+    /**
+     * Time the frontend took to render a frame.
+     */
+    Histogram& render;
+    /**
+     * How far the timer ticks are behind the wall clock, negative while they are ahead.
+     */
+    Gauge& timer_drift;
+  };
+
+  /**
+   * Periodically writes the metrics to a file, e.g. for the textfile collector of the Prometheus node exporter.
+   *
+   * The file is replaced atomically, so readers never see a partially written file.
+   */
+  class MetricsFileExporter final {
+  public:
+    /**
+     * Start writing the metrics on a background thread.
+     *
+     * @param registry The metrics to write, must outlive the exporter.
+     * @param path The file to write to.
+     * @param interval The time between two writes.
+     * @throws MetricsException if the file cannot be written.
+     */
+    MetricsFileExporter(MetricsRegistry const& registry, std::filesystem::path path,
+        std::chrono::milliseconds interval = std::chrono::seconds{1});
+
+    MetricsFileExporter(MetricsFileExporter const&) = delete;
+
+    MetricsFileExporter& operator=(MetricsFileExporter const&) = delete;
+
+    /**
+     * Write the metrics a last time and stop the background thread.
+     */
+    ~MetricsFileExporter() noexcept;
+
+  private:
+    MetricsRegistry const& registry_;
+    std::filesystem::path path_;
+    std::chrono::milliseconds interval_;
+    std::mutex mutex_{};
+    std::condition_variable stop_requested_{};
+    bool stop_{false};
+    std::thread thread_;
+
+    bool write() const;
+  };
+}
+
+#endif // CHIP8_VM_METRICS_HXX
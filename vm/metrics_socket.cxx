@@ -0,0 +1,72 @@
+#include "metrics_socket.hxx"
+
+#include <cstring>
+#include <string>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace chip8 {
+  MetricsSocketExporter::MetricsSocketExporter(MetricsRegistry const& registry, std::filesystem::path path)
+      :registry_{registry}, path_{std::move(path)}
+  {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    auto const& native = path_.native();
+    if (native.size()>=sizeof(address.sun_path))
+      throw MetricsException{"Metrics socket path is too long"};
+    std::memcpy(address.sun_path, native.c_str(), native.size()+1u);
+
+    // only a socket left behind by an earlier run is replaced, never a file that happens to be at the path
+    struct stat info{};
+    if (lstat(native.c_str(), &info)==0 && !S_ISSOCK(info.st_mode))
+      throw MetricsException{"Metrics socket path " + native + " exists and is not a socket"};
+
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_<0)
+      throw MetricsException{"Could not create metrics socket"};
+
+    if (S_ISSOCK(info.st_mode))
+      ::unlink(native.c_str());
+    if (bind(fd_, reinterpret_cast<sockaddr const*>(&address), sizeof(address))!=0 || listen(fd_, 4)!=0) {
+      ::close(fd_);
+      throw MetricsException{"Could not bind metrics socket"};
+    }
+
+    thread_ = std::thread{[this] { serve(); }};
+  }
+
+  MetricsSocketExporter::~MetricsSocketExporter() noexcept
+  {
+    stop_ = true;
+    thread_.join();
+    ::close(fd_);
+    ::unlink(path_.c_str());
+  }
+
+  void MetricsSocketExporter::serve() const
+  {
+    while (!stop_) {
+      pollfd listening{.fd = fd_, .events = POLLIN, .revents = 0};
+      if (poll(&listening, 1, POLL_TIMEOUT_MS)<=0)
+        continue;
+
+      auto const connection = accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (connection<0)
+        continue;
+
+      auto const text = registry_.text();
+      std::size_t written = 0u;
+      while (written<text.size()) {
+        auto const result = send(connection, text.data()+written, text.size()-written, MSG_NOSIGNAL);
+        if (result<=0)
+          break;
+        written += static_cast<std::size_t>(result);
+      }
+      ::close(connection);
+    }
+  }
+}
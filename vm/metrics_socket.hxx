@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef CHIP8_VM_METRICS_SOCKET_HXX
+#define CHIP8_VM_METRICS_SOCKET_HXX
+
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+#include "metrics.hxx"
+
+namespace chip8 {
+  /**
+   * Serves the metrics over a Unix domain socket.
+   *
+   * Every connection gets the current metrics in the Prometheus text format and is closed afterwards,
+   * e.g. `socat - UNIX-CONNECT:<path>`.
+   */
+  class MetricsSocketExporter final {
+  public:
+    /**
+     * Create the socket and start serving on a background thread.
+     *
+     * @param registry The metrics to serve, must outlive the exporter.
+     * @param path The path of the socket. An existing socket at the path is replaced, anything else is left alone.
+     * @throws MetricsException if the socket cannot be created or something other than a socket exists at the path.
+     */
+    MetricsSocketExporter(MetricsRegistry const& registry, std::filesystem::path path);
+
+    MetricsSocketExporter(MetricsSocketExporter const&) = delete;
+
+    MetricsSocketExporter& operator=(MetricsSocketExporter const&) = delete;
+
+    /**
+     * Stops serving and removes the socket.
+     */
+    ~MetricsSocketExporter() noexcept;
+
+  private:
+    /**
+     * Time the background thread waits for connections before checking whether it should stop.
+     */
+    static int constexpr POLL_TIMEOUT_MS = 100;
+
+    MetricsRegistry const& registry_;
+    std::filesystem::path path_;
+    int fd_{-1};
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+
+    void serve() const;
+  };
+}
+
+#endif // CHIP8_VM_METRICS_SOCKET_HXX
@@ -0,0 +1,131 @@
+#include "packed_screen.hxx"
+
+namespace chip8 {
+  namespace {
+    PixelRow constexpr pixel_mask(std::uint8_t const x) noexcept
+    {
+      return PixelRow{.high = std::uint64_t{1u} << 63u, .low = 0u} >> x;
+    }
+  }
+
+  void PackedScreen::clear()
+  {
+    for (auto& row: rows_) {
+      row.high.store(0u, std::memory_order_relaxed);
+      row.low.store(0u, std::memory_order_relaxed);
+    }
+    bump_version();
+  }
+
+  bool PackedScreen::get_pixel(std::uint8_t const x, std::uint8_t const y)
+  {
+    return load(y).test(x);
+  }
+
+  void PackedScreen::set_pixel(std::uint8_t const x, std::uint8_t const y, bool const state)
+  {
+    auto const row = load(y);
+    auto const mask = pixel_mask(x);
+    store(y, state ? (row | mask) : (row ^ (row & mask)));
+    bump_version();
+  }
+
+  void PackedScreen::set_high_resolution(bool const enabled)
+  {
+    high_resolution_.store(enabled, std::memory_order_relaxed);
+    clear();
+  }
+
+  bool PackedScreen::high_resolution() const
+  {
+    return high_resolution_.load(std::memory_order_relaxed);
+  }
+
+  bool PackedScreen::draw_sprite(std::uint8_t const x, std::uint8_t const y, std::span<std::uint16_t const> const rows)
+  {
+    auto const visible = this->visible();
+    auto const height = this->height();
+    PixelRow collisions{};
+    for (std::size_t n = 0; n<rows.size() && y+n<height; ++n) {
+      auto const row_y = static_cast<std::uint8_t>(y+n);
+      auto const sprite = (PixelRow{.high = static_cast<std::uint64_t>(rows[n]) << 48u, .low = 0u} >> x) & visible;
+      auto const row = load(row_y);
+      collisions = collisions | (row & sprite);
+      store(row_y, row ^ sprite);
+    }
+    bump_version();
+    return collisions.any();
+  }
+
+  void PackedScreen::scroll_down(std::uint8_t const rows)
+  {
+    for (auto y = height(); y--;)
+      store(y, y>=rows ? load(static_cast<std::uint8_t>(y-rows)) : PixelRow{});
+    bump_version();
+  }
+
+  void PackedScreen::scroll_left()
+  {
+    auto const visible = this->visible();
+    for (std::uint8_t y = 0; y<height(); ++y)
+      store(y, (load(y) << SCROLL_STEP) & visible);
+    bump_version();
+  }
+
+  void PackedScreen::scroll_right()
+  {
+    auto const visible = this->visible();
+    for (std::uint8_t y = 0; y<height(); ++y)
+      store(y, (load(y) >> SCROLL_STEP) & visible);
+    bump_version();
+  }
+
+  PixelRow PackedScreen::load(std::uint8_t const y) const noexcept
+  {
+    return PixelRow{
+        .high = rows_[y].high.load(std::memory_order_relaxed),
+        .low = rows_[y].low.load(std::memory_order_relaxed),
+    };
+  }
+
+  void PackedScreen::store(std::uint8_t const y, PixelRow const row) noexcept
+  {
+    rows_[y].high.store(row.high, std::memory_order_relaxed);
+    rows_[y].low.store(row.low, std::memory_order_relaxed);
+  }
+
+  PixelRow PackedScreen::visible() const noexcept
+  {
+    return PixelRow{.high = ~std::uint64_t{0u}, .low = high_resolution() ? ~std::uint64_t{0u} : 0u};
+  }
+
+  void PackedScreen::bump_version() noexcept
+  {
+    // only the processor thread draws, so there is no need for an atomic read-modify-write
+    version_.store(version_.load(std::memory_order_relaxed)+1u, std::memory_order_release);
+  }
+
+  FrameBuffer PackedScreen::frame() const noexcept
+  {
+    FrameBuffer frame{};
+    version_.load(std::memory_order_acquire);
+    frame.high_resolution = high_resolution();
+    // pixels outside of the current resolution are always turned off, so there is no need to read them
+    for (std::uint8_t y = 0; y<frame.height(); ++y)
+      frame.rows[y] = load(y);
+    return frame;
+  }
+
+  void PackedScreen::restore(FrameBuffer const& frame) noexcept
+  {
+    high_resolution_.store(frame.high_resolution, std::memory_order_relaxed);
+    for (std::uint8_t y = 0; y<frame.rows.size(); ++y)
+      store(y, frame.rows[y]);
+    bump_version();
+  }
+
+  std::uint64_t PackedScreen::version() const noexcept
+  {
+    return version_.load(std::memory_order_acquire);
+  }
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#ifndef CHIP8_VM_PACKED_SCREEN_HXX
+#define CHIP8_VM_PACKED_SCREEN_HXX
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "screen.hxx"
+
+namespace chip8 {
+  /**
+   * A row of pixels packed into a 128 bit word, the most significant bit being the leftmost pixel.
+   *
+   * The word is made of two 64 bit halves, which compilers turn into double-word shifts
+   * without depending on a 128 bit integer type.
+   */
+  struct PixelRow final {
+    /**
+     * Pixels 0 to 63, the only ones used in the low resolution.
+     */
+    std::uint64_t high{0u};
+    /**
+     * Pixels 64 to 127.
+     */
+    std::uint64_t low{0u};
+
+    constexpr bool operator==(PixelRow const&) const noexcept = default;
+
+    [[nodiscard]] constexpr bool test(std::uint8_t const x) const noexcept
+    {
+      return x<64u ? ((high >> (63u-x)) & 1u)!=0u : ((low >> (127u-x)) & 1u)!=0u;
+    }
+
+    [[nodiscard]] constexpr bool any() const noexcept
+    {
+      return (high | low)!=0u;
+    }
+
+    constexpr PixelRow operator<<(unsigned const shift) const noexcept
+    {
+      if (shift==0u)
+        return *this;
+      if (shift<64u)
+        return PixelRow{.high = (high << shift) | (low >> (64u-shift)), .low = low << shift};
+      return PixelRow{.high = shift<128u ? low << (shift-64u) : 0u, .low = 0u};
+    }
+
+    constexpr PixelRow operator>>(unsigned const shift) const noexcept
+    {
+      if (shift==0u)
+        return *this;
+      if (shift<64u)
+        return PixelRow{.high = high >> shift, .low = (low >> shift) | (high << (64u-shift))};
+      return PixelRow{.high = 0u, .low = shift<128u ? high >> (shift-64u) : 0u};
+    }
+
+    constexpr PixelRow operator&(PixelRow const& rhs) const noexcept
+    {
+      return PixelRow{.high = high & rhs.high, .low = low & rhs.low};
+    }
+
+    constexpr PixelRow operator|(PixelRow const& rhs) const noexcept
+    {
+      return PixelRow{.high = high | rhs.high, .low = low | rhs.low};
+    }
+
+    constexpr PixelRow operator^(PixelRow const& rhs) const noexcept
+    {
+      return PixelRow{.high = high ^ rhs.high, .low = low ^ rhs.low};
+    }
+  };
+
+  /**
+   * A frame with every row packed into a PixelRow.
+   *
+   * In the low resolution only the top left 64x32 pixels are used, the others are always turned off.
+   */
+  struct FrameBuffer final {
+    std::array<PixelRow, Screen::HIRES_HEIGHT> rows{};
+    bool high_resolution{false};
+
+    bool operator==(FrameBuffer const&) const noexcept = default;
+
+    [[nodiscard]] constexpr std::uint8_t width() const noexcept
+    {
+      return high_resolution ? Screen::HIRES_WIDTH : Screen::WIDTH;
+    }
+
+    [[nodiscard]] constexpr std::uint8_t height() const noexcept
+    {
+      return high_resolution ? Screen::HIRES_HEIGHT : Screen::HEIGHT;
+    }
+
+    [[nodiscard]] constexpr bool pixel(std::uint8_t const x, std::uint8_t const y) const noexcept
+    {
+      return rows[y].test(x);
+    }
+  };
+
+  static_assert(Screen::HIRES_WIDTH==128u, "PixelRow must hold exactly one row of pixels");
+
+  /**
+   * Screen storing its pixels as a packed FrameBuffer.
+   *
+   * The processor thread draws into it while other threads can take snapshots of the current frame at any time.
+   * It serves as the base for frontends that do not have a pixel buffer of their own.
+   * Sprites and scrolling work on whole rows, so they take a few shifts per row instead of a call per pixel.
+   */
+  class PackedScreen : public Screen {
+  public:
+    void clear() final;
+
+    bool get_pixel(std::uint8_t x, std::uint8_t y) final;
+
+    void set_pixel(std::uint8_t x, std::uint8_t y, bool state) final;
+
+    void set_high_resolution(bool enabled) final;
+
+    [[nodiscard]] bool high_resolution() const final;
+
+    bool draw_sprite(std::uint8_t x, std::uint8_t y, std::span<std::uint16_t const> rows) final;
+
+    void scroll_down(std::uint8_t rows) final;
+
+    void scroll_left() final;
+
+    void scroll_right() final;
+
+    /**
+     * Take a snapshot of the current frame.
+     *
+     * Rows are read one by one, so a snapshot taken while drawing may contain a partially drawn sprite.
+     *
+     * @return The current frame.
+     */
+    [[nodiscard]] FrameBuffer frame() const noexcept;
+
+    /**
+     * Replace the whole frame, e.g. to continue from a snapshot taken with frame().
+     *
+     * @param frame The new frame.
+     */
+    void restore(FrameBuffer const& frame) noexcept;
+
+    /**
+     * Get a counter that changes whenever the frame changes.
+     *
+     * @return The number of changes to the frame so far.
+     */
+    [[nodiscard]] std::uint64_t version() const noexcept;
+
+  private:
+    struct AtomicRow final {
+      std::atomic<std::uint64_t> high{0u};
+      std::atomic<std::uint64_t> low{0u};
+    };
+
+    std::array<AtomicRow, HIRES_HEIGHT> rows_{};
+    std::atomic<bool> high_resolution_{false};
+    std::atomic<std::uint64_t> version_{0u};
+
+    [[nodiscard]] PixelRow load(std::uint8_t y) const noexcept;
+
+    void store(std::uint8_t y, PixelRow row) noexcept;
+
+    /**
+     * Get the pixels of a row which are part of the current resolution.
+     */
+    [[nodiscard]] PixelRow visible() const noexcept;
+
+    void bump_version() noexcept;
+  };
+}
+
+#endif // CHIP8_VM_PACKED_SCREEN_HXX
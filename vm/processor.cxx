@@ -1,17 +1,246 @@
 #include "processor.hxx"
+#include "trace.hxx"
 
+#include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include <sstream>
 
 namespace chip8 {
-  Processor::Processor(Config const& config, CallStack& call_stack, Memory& memory, Screen& screen,
-      Logger& logger) noexcept
-      :config_{config}, call_stack_{call_stack}, memory_{memory}, screen_{screen}, logger_{logger}
+  namespace {
+    /**
+     * Get the registers an instruction may write, bit n standing for Vn.
+     */
+    std::uint16_t written_registers(std::uint16_t const opcode) noexcept
+    {
+      auto const x = static_cast<unsigned>((opcode >> 8) & 0xFu);
+      auto const vx = static_cast<std::uint16_t>(1u << x);
+      std::uint16_t constexpr VF = 0x8000u;
+      switch (opcode >> 12) {
+      default:
+        return 0u;
+      case 0x6u:
+      case 0x7u:
+      case 0xCu:
+        return vx;
+      case 0x8u:
+        // the logical operations leave VF alone, the arithmetic ones and shifts store their flag in it
+        return (opcode & 0xFu)<=0x3u ? vx : static_cast<std::uint16_t>(vx | VF);
+      case 0xDu:
+        return VF;
+      case 0xFu:
+        switch (opcode & 0xFFu) {
+        default:
+          return 0u;
+        case 0x07u:
+        case 0x0Au:
+          return vx;
+        case 0x1Eu:
+          return VF;
+        case 0x65u:
+          return static_cast<std::uint16_t>((2u << x)-1u);
+        }
+      }
+    }
+  }
+
+  template<QuirkSet Quirks>
+  BasicProcessor<Quirks>::BasicProcessor(Quirks const& quirks, CallStack& call_stack, Memory& memory, Screen& screen,
+      Audio& audio, Logger& logger) noexcept
+      :quirks_{quirks}, call_stack_{call_stack}, memory_{memory}, screen_{screen}, audio_{audio}, logger_{logger}
   {
     memory_.load_default_font(FONT_START);
   }
 
-  bool Processor::step()
+  template<QuirkSet Quirks>
+  bool BasicProcessor<Quirks>::step()
+  {
+    if ((cycles_ & (INPUT_BATCH-1u))==0u)
+      process_input();
+
+    auto const result = tracer_ ? traced_step() : execute();
+    ++cycles_;
+
+    if (bool const beeping = sound_timer_>0u; beeping!=beeping_) {
+      beeping_ = beeping;
+      audio_.beeper(beeping, cycles_);
+    }
+    return result;
+  }
+
+  template<QuirkSet Quirks>
+  RunResult BasicProcessor<Quirks>::run(std::uint64_t const max_cycles, StopOn const stop_on)
+  {
+    return run_until(cycles_+max_cycles, stop_on);
+  }
+
+  template<QuirkSet Quirks>
+  RunResult BasicProcessor<Quirks>::run_until(std::uint64_t const cycle, StopOn const stop_on)
+  {
+    auto const start = cycles_;
+    while (cycles_<cycle) {
+      auto const pc = pc_;
+      if (has_breakpoints_ && cycles_!=start && breakpoints_.test(static_cast<std::uint16_t>(pc)))
+        return stopped(StopReason::Breakpoint, start, pc);
+
+      drew_ = false;
+      if (!step()) {
+        auto const reason = fault_;
+        fault_ = StopReason::UnsupportedInstruction;
+        return stopped(reason, start, pc);
+      }
+      if (stop_on.draw && drew_)
+        return stopped(StopReason::Draw, start, pc);
+      if (stop_on.waiting_for_key && get_key_state_==GetKeyState::WaitingForKey)
+        return stopped(StopReason::WaitingForKey, start, pc);
+    }
+    return stopped(StopReason::BudgetExhausted, start, pc_);
+  }
+
+  template<QuirkSet Quirks>
+  RunResult BasicProcessor<Quirks>::stopped(StopReason const reason, std::uint64_t const start, Address const pc) const
+  {
+    return RunResult{
+        .reason = reason,
+        .cycles = cycles_-start,
+        .pc = pc,
+        .opcode = static_cast<std::uint16_t>((memory_[pc] << 8) | memory_[pc+1]),
+    };
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::set_breakpoint(Address const address)
+  {
+    breakpoints_.set(static_cast<std::uint16_t>(address));
+    has_breakpoints_ = true;
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::clear_breakpoint(Address const address)
+  {
+    breakpoints_.reset(static_cast<std::uint16_t>(address));
+    has_breakpoints_ = breakpoints_.any();
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::clear_breakpoints() noexcept
+  {
+    if (has_breakpoints_)
+      breakpoints_.reset();
+    has_breakpoints_ = false;
+  }
+
+  template<QuirkSet Quirks>
+  std::uint64_t BasicProcessor<Quirks>::cycles() const noexcept
+  {
+    return cycles_;
+  }
+
+  template<QuirkSet Quirks>
+  Address BasicProcessor<Quirks>::pc() const noexcept
+  {
+    return pc_;
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::set_tracer(TraceWriter* const tracer) noexcept
+  {
+    tracer_ = tracer;
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::set_metrics(EmulatorMetrics* const metrics) noexcept
+  {
+    metrics_ = metrics;
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::set_latency_tracer(InputLatencyTracer* const tracer) noexcept
+  {
+    latency_tracer_ = tracer;
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::seed(std::uint32_t const seed)
+  {
+    rng_.seed(seed);
+    dist_.reset();
+  }
+
+  template<QuirkSet Quirks>
+  ProcessorState BasicProcessor<Quirks>::state() const
+  {
+    return ProcessorState{
+        .pc = pc_,
+        .i = i_,
+        .delay_timer = delay_timer_,
+        .sound_timer = sound_timer_,
+        .v = v_,
+        .cycles = cycles_,
+        .beeping = beeping_,
+        .keys = keys_,
+        .get_key_state = get_key_state_,
+        .last_key = last_key_,
+        .rng = rng_,
+    };
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::restore(ProcessorState const& state)
+  {
+    pc_ = state.pc;
+    i_ = state.i;
+    delay_timer_ = state.delay_timer;
+    sound_timer_ = state.sound_timer;
+    v_ = state.v;
+    cycles_ = state.cycles;
+    beeping_ = state.beeping;
+    keys_ = state.keys;
+    get_key_state_ = state.get_key_state;
+    last_key_ = state.last_key;
+    rng_ = state.rng;
+    dist_.reset();
+
+    while (key_events_.pop()) {
+    }
+  }
+
+  template<QuirkSet Quirks>
+  bool BasicProcessor<Quirks>::traced_step()
+  {
+    auto const pc = pc_;
+    auto const opcode = static_cast<std::uint16_t>((memory_[pc_] << 8) | memory_[pc_+1]);
+    auto const index = i_;
+    auto const halted = !execute();
+
+    // Fx33 and Fx55 are the only instructions writing to memory, only they pay for copying it
+    std::array<std::uint8_t, 16u> written;
+    std::uint8_t written_length = 0u;
+    if (!halted && (opcode & 0xF0FFu)==0xF033u)
+      written_length = 3u;
+    else if (!halted && (opcode & 0xF0FFu)==0xF055u)
+      written_length = static_cast<std::uint8_t>(((opcode >> 8) & 0xFu)+1u);
+    for (std::uint8_t n = 0; n<written_length; ++n)
+      written[n] = memory_[index+n];
+
+    tracer_->record(TraceStep{
+        .pc = pc,
+        .opcode = opcode,
+        .halted = halted,
+        .i = i_,
+        .delay_timer = delay_timer_,
+        .sound_timer = sound_timer_,
+        .written_registers = written_registers(opcode),
+        .v = v_.data(),
+        .memory_address = index,
+        .memory_length = written_length,
+        .memory = written.data(),
+    });
+    return !halted;
+  }
+
+  template<QuirkSet Quirks>
+  bool BasicProcessor<Quirks>::execute()
   {
     auto const first_byte = memory_[pc_++];
     auto const nn = memory_[pc_++];
@@ -41,8 +270,7 @@ namespace chip8 {
       jump(nnn);
       return true;
     case 0x2:
-      call(nnn);
-      return true;
+      return call(nnn);
     case 0x3:
       skip_if_equal_to(x, nn);
       return true;
@@ -82,8 +310,12 @@ namespace chip8 {
     }
   }
 
-  bool Processor::native_instruction(std::uint16_t const param)
+  template<QuirkSet Quirks>
+  bool BasicProcessor<Quirks>::native_instruction(std::uint16_t const param)
   {
+    if (quirks_.supports_high_resolution && high_resolution_instruction(param))
+      return true;
+
     switch (param) {
     default: {
       std::ostringstream msg;
@@ -99,110 +331,203 @@ namespace chip8 {
     case 0x0E0:
       logger_.debug("Instruction: Clear screen");
       screen_.clear();
+      drew_ = true;
       return true;
     case 0x0EE:
       logger_.debug("Instruction: Return");
       if (auto const next_pc = call_stack_.pop(); next_pc.has_value()) {
-        std::ostringstream msg;
-        msg << "Returning to 0x"
-            << std::setfill('0') << std::setw(3) << std::hex
-            << static_cast<std::uint16_t>(*next_pc);
-        logger_.debug(msg.str().c_str());
+        if (logger_.debug_enabled()) {
+          std::ostringstream msg;
+          msg << "Returning to 0x"
+              << std::setfill('0') << std::setw(3) << std::hex
+              << static_cast<std::uint16_t>(*next_pc);
+          logger_.debug(msg.str().c_str());
+        }
         pc_ = *next_pc;
         return true;
       }
       else {
         logger_.error("No return address on stack");
+        fault_ = StopReason::StackUnderflow;
         return false;
       }
     }
   }
 
-  void Processor::jump(std::uint16_t const param)
+  /**
+   * Execute the display instructions SUPER-CHIP added.
+   *
+   * @return true, if the instruction is one of them, false otherwise.
+   */
+  template<QuirkSet Quirks>
+  bool BasicProcessor<Quirks>::high_resolution_instruction(std::uint16_t const param)
+  {
+    if ((param & 0xFF0u)==0x0C0u) {
+      scroll_down(static_cast<std::uint8_t>(param & 0xFu));
+      return true;
+    }
+
+    switch (param) {
+    default:
+      return false;
+    case 0x0FB:
+      scroll_right();
+      return true;
+    case 0x0FC:
+      scroll_left();
+      return true;
+    case 0x0FE:
+      set_high_resolution(false);
+      return true;
+    case 0x0FF:
+      set_high_resolution(true);
+      return true;
+    }
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::jump(std::uint16_t const param)
   {
     logger_.debug("Instruction: Jump");
-    std::ostringstream msg;
-    msg << "Jumping to 0x"
-        << std::setfill('0') << std::setw(3) << std::hex << (param & Address::VALUE_MASK);
-    logger_.debug(msg.str().c_str());
+    if (logger_.debug_enabled()) {
+      std::ostringstream msg;
+      msg << "Jumping to 0x"
+          << std::setfill('0') << std::setw(3) << std::hex << (param & Address::VALUE_MASK);
+      logger_.debug(msg.str().c_str());
+    }
     pc_ = Address{param, Address::Truncate{}};
   }
 
-  void Processor::call(std::uint16_t param)
+  template<QuirkSet Quirks>
+  bool BasicProcessor<Quirks>::call(std::uint16_t param)
   {
     logger_.debug("Instruction: Call");
-    std::ostringstream msg;
-    msg << "Jumping to 0x"
-        << std::setfill('0') << std::setw(3) << std::hex << (param & Address::VALUE_MASK);
-    logger_.debug(msg.str().c_str());
-    call_stack_.push(pc_);
+    if (logger_.debug_enabled()) {
+      std::ostringstream msg;
+      msg << "Jumping to 0x"
+          << std::setfill('0') << std::setw(3) << std::hex << (param & Address::VALUE_MASK);
+      logger_.debug(msg.str().c_str());
+    }
+    if (!call_stack_.push(pc_)) {
+      logger_.error("Call stack overflow");
+      fault_ = StopReason::StackOverflow;
+      return false;
+    }
     pc_ = Address{param, Address::Truncate{}};
+    return true;
   }
 
-  void Processor::set_register(std::uint8_t const index, std::uint8_t const value)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::set_register(std::uint8_t const index, std::uint8_t const value)
   {
     logger_.debug("Instruction: Set register");
-    std::ostringstream msg;
-    msg << "V"
-        << std::hex << static_cast<int>(index)
-        << " = " << static_cast<int>(value);
-    logger_.debug(msg.str().c_str());
+    if (logger_.debug_enabled()) {
+      std::ostringstream msg;
+      msg << "V"
+          << std::hex << static_cast<int>(index)
+          << " = " << static_cast<int>(value);
+      logger_.debug(msg.str().c_str());
+    }
     v_[index] = value;
   }
 
-  void Processor::add_to_register(std::uint8_t const index, std::uint8_t const value)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::add_to_register(std::uint8_t const index, std::uint8_t const value)
   {
     logger_.debug("Instruction: Add value to register");
-    std::ostringstream msg;
-    msg << "V"
-        << std::hex << static_cast<int>(index)
-        << " += " << static_cast<int>(value);
-    logger_.debug(msg.str().c_str());
+    if (logger_.debug_enabled()) {
+      std::ostringstream msg;
+      msg << "V"
+          << std::hex << static_cast<int>(index)
+          << " += " << static_cast<int>(value);
+      logger_.debug(msg.str().c_str());
+    }
     v_[index] += value;
   }
 
-  void Processor::set_index_register(std::uint16_t const value)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::set_index_register(std::uint16_t const value)
   {
     logger_.debug("Instruction: Set index register");
-    std::ostringstream msg;
-    msg << "I = " << value;
-    logger_.debug(msg.str().c_str());
+    if (logger_.debug_enabled()) {
+      std::ostringstream msg;
+      msg << "I = " << value;
+      logger_.debug(msg.str().c_str());
+    }
     i_ = Address{value, Address::Truncate{}};
   }
 
-  void Processor::draw(std::uint8_t const x_register, std::uint8_t const y_register, std::uint8_t const sprite_size)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::draw(std::uint8_t const x_register, std::uint8_t const y_register, std::uint8_t const sprite_size)
   {
     logger_.debug("Instruction: Draw");
+    std::chrono::steady_clock::time_point started{};
+    if (metrics_!=nullptr)
+      started = std::chrono::steady_clock::now();
+
+    // only profiles supporting the high resolution can switch to it, the others save asking the screen
+    auto const high_resolution = quirks_.supports_high_resolution && screen_.high_resolution();
+    auto const width = high_resolution ? Screen::HIRES_WIDTH : Screen::WIDTH;
+    auto const height = high_resolution ? Screen::HIRES_HEIGHT : Screen::HEIGHT;
+    auto const start_x = static_cast<std::uint8_t>(v_[x_register]%width);
+    auto const start_y = static_cast<std::uint8_t>(v_[y_register]%height);
+
+    // sprites are 8 pixels wide, except for the 16x16 sprites SUPER-CHIP draws for a size of 0
+    std::array<std::uint16_t, 16u> rows{};
+    int count = sprite_size;
+    if (sprite_size==0u && quirks_.supports_high_resolution) {
+      count = static_cast<int>(rows.size());
+      for (int n = 0; n<count; ++n)
+        rows[n] = static_cast<std::uint16_t>((memory_[i_+2*n] << 8) | memory_[i_+2*n+1]);
+    }
+    else {
+      for (int n = 0; n<count; ++n)
+        rows[n] = static_cast<std::uint16_t>(memory_[i_+n] << 8);
+    }
 
-    auto const start_x = static_cast<std::uint8_t>(v_[x_register]%Screen::WIDTH);
-    auto const start_y = static_cast<std::uint8_t>(v_[y_register]%Screen::HEIGHT);
-    v_[0xF] = 0;
-
-    auto x = start_x, y = start_y;
-    for (int n = 0; n<sprite_size; ++n) {
-      auto byte = memory_[i_+n];
-      for (int bit = 8; bit--; byte <<= 1) {
-        bool const pixel = !!(byte & 0x80);
-        if (pixel) {
-          if (screen_.get_pixel(x, y)) {
-            v_[0xF] = 1;
-            screen_.set_pixel(x, y, false);
-          }
-          else
-            screen_.set_pixel(x, y, true);
-        }
+    v_[0xF] = screen_.draw_sprite(start_x, start_y, std::span{rows.data(), static_cast<std::size_t>(count)}) ? 1 : 0;
+    drew_ = true;
+    if (metrics_!=nullptr)
+      metrics_->draw.observe(std::chrono::steady_clock::now()-started);
+    // empty sprites leave the frame as it is
+    if (latency_tracer_!=nullptr && std::ranges::any_of(rows, [](auto const row) { return row!=0u; }))
+      latency_tracer_->drawn();
+  }
 
-        if (++x==Screen::WIDTH) {
-          break;
-        }
-      }
-      x = start_x;
-      if (++y==Screen::HEIGHT)
-        break;
-    }
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::scroll_down(std::uint8_t const rows)
+  {
+    logger_.debug("Instruction: Scroll down");
+    screen_.scroll_down(rows);
+    drew_ = true;
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::scroll_left()
+  {
+    logger_.debug("Instruction: Scroll left");
+    screen_.scroll_left();
+    drew_ = true;
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::scroll_right()
+  {
+    logger_.debug("Instruction: Scroll right");
+    screen_.scroll_right();
+    drew_ = true;
   }
 
-  bool Processor::register_instruction(std::uint8_t const index, std::uint16_t const instruction)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::set_high_resolution(bool const enabled)
+  {
+    logger_.debug(enabled ? "Instruction: High resolution" : "Instruction: Low resolution");
+    screen_.set_high_resolution(enabled);
+    drew_ = true;
+  }
+
+  template<QuirkSet Quirks>
+  bool BasicProcessor<Quirks>::register_instruction(std::uint8_t const index, std::uint16_t const instruction)
   {
     switch (instruction) {
     default: {
@@ -226,7 +551,7 @@ namespace chip8 {
       set_delay_timer(index);
       return true;
     case 0x18:
-      logger_.warn("Ignoring sound timer");
+      set_sound_timer(index);
       return true;
     case 0x1E:
       add_to_index_register(index);
@@ -246,92 +571,140 @@ namespace chip8 {
     }
   }
 
-  void Processor::store_to_memory(std::uint8_t const index)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::store_to_memory(std::uint8_t const index)
   {
     logger_.debug("Instruction: Store registers to memory");
     for (std::uint8_t n = 0; n<=index; ++n) {
-      memory_[i_+n] = v_[n];
+      memory_.write(i_+n, v_[n]);
     }
-    if (config_.register_rw_modifies_i)
+    if (quirks_.register_rw_modifies_i)
       i_ += index+1;
   }
 
-  void Processor::load_from_memory(std::uint8_t const index)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::load_from_memory(std::uint8_t const index)
   {
     logger_.debug("Instruction: Load registers from memory");
     for (std::uint8_t n = 0; n<=index; ++n) {
       v_[n] = memory_[i_+n];
     }
-    if (config_.register_rw_modifies_i)
+    if (quirks_.register_rw_modifies_i)
       i_ += index+1;
   }
 
-  void Processor::update_timers()
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::update_timers()
   {
     if (delay_timer_>0u)
       --delay_timer_;
 
-    // if (sound_timer_>0u)
-    //   --sound_timer_;
+    if (sound_timer_>0u)
+      --sound_timer_;
   }
 
-  void Processor::get_delay_timer(std::uint8_t const index)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::get_delay_timer(std::uint8_t const index)
   {
     logger_.debug("Instruction: Get delay timer");
     v_[index] = delay_timer_;
   }
 
-  void Processor::set_delay_timer(std::uint8_t const index)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::set_delay_timer(std::uint8_t const index)
   {
     logger_.debug("Instruction: Set delay timer");
     delay_timer_ = v_[index];
   }
 
-  void Processor::skip_if_equal_to(std::uint8_t const index, std::uint8_t const value)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::set_sound_timer(std::uint8_t const index)
+  {
+    logger_.debug("Instruction: Set sound timer");
+    sound_timer_ = v_[index];
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::skip_if_equal_to(std::uint8_t const index, std::uint8_t const value)
   {
     logger_.debug("Instruction: Skip if equal to constant");
     if (v_[index]==value)
       pc_ += 2;
   }
 
-  void Processor::skip_unless_equal_to(std::uint8_t const index, std::uint8_t const value)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::skip_unless_equal_to(std::uint8_t const index, std::uint8_t const value)
   {
     logger_.debug("Instruction: Skip unless equal to constant");
     if (v_[index]!=value)
       pc_ += 2;
   }
 
-  void Processor::skip_if_equal(std::uint8_t const x, std::uint8_t const y)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::skip_if_equal(std::uint8_t const x, std::uint8_t const y)
   {
     logger_.debug("Instruction: Skip if registers are equal");
     if (v_[x]==v_[y])
       pc_ += 2;
   }
 
-  void Processor::skip_unless_equal(std::uint8_t const x, std::uint8_t const y)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::skip_unless_equal(std::uint8_t const x, std::uint8_t const y)
   {
     logger_.debug("Instruction: Skip unless registers are equal");
     if (v_[x]!=v_[y])
       pc_ += 2;
   }
 
-  void Processor::toggle_key(std::uint8_t const index, bool const pressed)
+  template<QuirkSet Quirks>
+  bool BasicProcessor<Quirks>::toggle_key(std::uint8_t const index, bool const pressed)
   {
     if (index>0xF)
-      return;
+      return false;
 
-    if (pressed)
-      keys_ |= (1u << index);
+    auto const now = std::chrono::steady_clock::now().time_since_epoch();
+    return key_events_.push(KeyEvent{
+        .key = index,
+        .pressed = pressed,
+        .queued_at = static_cast<std::uint64_t>(std::chrono::nanoseconds{now}.count()),
+        .applied_cycle = 0u,
+    });
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::process_input()
+  {
+    while (auto const event = key_events_.pop())
+      apply_key(*event);
+  }
+
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::apply_key(KeyEvent event)
+  {
+    if (event.pressed)
+      keys_ |= (1u << event.key);
     else {
-      keys_ &= ~(1u << index);
+      keys_ &= ~(1u << event.key);
       if (get_key_state_==GetKeyState::WaitingForKey) {
-        last_key_ = index;
+        last_key_ = event.key;
         get_key_state_ = GetKeyState::GotKey;
       }
     }
+
+    event.applied_cycle = cycles_;
+    applied_key_events_.push(event);
+    if (latency_tracer_!=nullptr)
+      latency_tracer_->applied(event);
   }
 
-  bool Processor::key_skips(std::uint8_t const index, std::uint8_t const instruction)
+  template<QuirkSet Quirks>
+  std::optional<KeyEvent> BasicProcessor<Quirks>::applied_input()
+  {
+    return applied_key_events_.pop();
+  }
+
+  template<QuirkSet Quirks>
+  bool BasicProcessor<Quirks>::key_skips(std::uint8_t const index, std::uint8_t const instruction)
   {
     switch (instruction) {
     default: {
@@ -354,21 +727,28 @@ namespace chip8 {
     }
   }
 
-  void Processor::skip_if_pressed(std::uint8_t const index)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::skip_if_pressed(std::uint8_t const index)
   {
     logger_.debug("Instruction: Skip if key pressed");
+    if (latency_tracer_!=nullptr)
+      latency_tracer_->observed(v_[index]);
     if (keys_ & (1u << v_[index]))
       pc_ += 2;
   }
 
-  void Processor::skip_unless_pressed(std::uint8_t const index)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::skip_unless_pressed(std::uint8_t const index)
   {
     logger_.debug("Instruction: Skip unless key pressed");
+    if (latency_tracer_!=nullptr)
+      latency_tracer_->observed(v_[index]);
     if (!(keys_ & (1u << v_[index])))
       pc_ += 2;
   }
 
-  void Processor::get_key(std::uint8_t const index)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::get_key(std::uint8_t const index)
   {
     logger_.debug("Instruction: Get key");
 
@@ -380,13 +760,16 @@ namespace chip8 {
       pc_ += -2;
       return;
     case GetKeyState::GotKey:
+      if (latency_tracer_!=nullptr)
+        latency_tracer_->observed(last_key_);
       v_[index] = last_key_;
       last_key_ = 0;
       get_key_state_ = GetKeyState::None;
     }
   }
 
-  void Processor::add_to_index_register(std::uint8_t const index)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::add_to_index_register(std::uint8_t const index)
   {
     logger_.debug("Instruction: Add to index register");
     std::uint16_t const sum = static_cast<std::uint16_t>(i_)+v_[index];
@@ -394,19 +777,23 @@ namespace chip8 {
     i_ = Address{sum, Address::Truncate{}};
   }
 
-  void Processor::font_character(std::uint8_t const index)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::font_character(std::uint8_t const index)
   {
     logger_.debug("Instruction: Font character");
     int const c = (v_[index] & 0xF);
 
-    std::ostringstream msg;
-    msg << "Loading character for " << std::hex << c;
-    logger_.debug(msg.str().c_str());
+    if (logger_.debug_enabled()) {
+      std::ostringstream msg;
+      msg << "Loading character for " << std::hex << c;
+      logger_.debug(msg.str().c_str());
+    }
 
     i_ = FONT_START+(c*5);
   }
 
-  bool Processor::binary_operator(std::uint8_t const x, std::uint8_t const y, std::uint8_t const instruction)
+  template<QuirkSet Quirks>
+  bool BasicProcessor<Quirks>::binary_operator(std::uint8_t const x, std::uint8_t const y, std::uint8_t const instruction)
   {
     switch (instruction) {
     default: {
@@ -450,31 +837,36 @@ namespace chip8 {
     }
   }
 
-  void Processor::assign_y_to_x(std::uint8_t const x, std::uint8_t const y)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::assign_y_to_x(std::uint8_t const x, std::uint8_t const y)
   {
     logger_.debug("Instruction: Assign Vy to Vx");
     v_[x] = v_[y];
   }
 
-  void Processor::binary_or(std::uint8_t const x, std::uint8_t const y)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::binary_or(std::uint8_t const x, std::uint8_t const y)
   {
     logger_.debug("Instruction: Binary Or");
     v_[x] = v_[x] | v_[y];
   }
 
-  void Processor::binary_and(std::uint8_t const x, std::uint8_t const y)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::binary_and(std::uint8_t const x, std::uint8_t const y)
   {
     logger_.debug("Instruction: Binary And");
     v_[x] = v_[x] & v_[y];
   }
 
-  void Processor::binary_xor(std::uint8_t const x, std::uint8_t const y)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::binary_xor(std::uint8_t const x, std::uint8_t const y)
   {
     logger_.debug("Instruction: Binary Xor");
     v_[x] = v_[x] ^ v_[y];
   }
 
-  void Processor::add_y_to_x(std::uint8_t const x, std::uint8_t const y)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::add_y_to_x(std::uint8_t const x, std::uint8_t const y)
   {
     logger_.debug("Instruction: Add registers with overflow");
     std::uint16_t const sum = v_[x]+v_[y];
@@ -482,7 +874,8 @@ namespace chip8 {
     v_[x] = sum & 0xFF;
   }
 
-  void Processor::subtract_y_from_x(std::uint8_t const x, std::uint8_t const y)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::subtract_y_from_x(std::uint8_t const x, std::uint8_t const y)
   {
     logger_.debug("Instruction: Subtract Vy from Vx");
 
@@ -493,7 +886,8 @@ namespace chip8 {
     v_[x] = result;
   }
 
-  void Processor::subtract_x_from_y(std::uint8_t const x, std::uint8_t const y)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::subtract_x_from_y(std::uint8_t const x, std::uint8_t const y)
   {
     logger_.debug("Instruction: Subtract Vx from Vy");
 
@@ -504,23 +898,26 @@ namespace chip8 {
     v_[x] = result;
   }
 
-  void Processor::shift_right(std::uint8_t const x, std::uint8_t const y)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::shift_right(std::uint8_t const x, std::uint8_t const y)
   {
     logger_.debug("Instruction: Shift right");
-    auto const source = config_.shift_takes_value_from_vy ? v_[y] : v_[x];
+    auto const source = quirks_.shift_takes_value_from_vy ? v_[y] : v_[x];
     v_[0xF] = (source & 0x1);
     v_[x] = source >> 1;
   }
 
-  void Processor::shift_left(std::uint8_t const x, std::uint8_t const y)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::shift_left(std::uint8_t const x, std::uint8_t const y)
   {
     logger_.debug("Instruction: Shift left");
-    auto const source = config_.shift_takes_value_from_vy ? v_[y] : v_[x];
+    auto const source = quirks_.shift_takes_value_from_vy ? v_[y] : v_[x];
     v_[0xF] = (source & 0x8F) >> 7;
     v_[x] = source << 1;
   }
 
-  void Processor::binary_coded_decimal(std::uint8_t const index)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::binary_coded_decimal(std::uint8_t const index)
   {
     logger_.debug("Instruction: Binary coded decimal");
 
@@ -536,26 +933,35 @@ namespace chip8 {
       d = 1;
 
     for (int n = 0; n<d; ++n)
-      memory_[i_+n] = digits[d-1-n];
+      memory_.write(i_+n, digits[d-1-n]);
   }
 
-  void Processor::random_number(std::uint8_t const x, std::uint8_t const mask)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::random_number(std::uint8_t const x, std::uint8_t const mask)
   {
     logger_.debug("Instruction: Random number");
     v_[x] = dist_(rng_) & mask;
   }
 
-  void Processor::jump_with_offset(std::uint8_t const x, std::uint16_t const nnn)
+  template<QuirkSet Quirks>
+  void BasicProcessor<Quirks>::jump_with_offset(std::uint8_t const x, std::uint16_t const nnn)
   {
     logger_.debug("Instruction: Jump with offset");
 
     auto const base = Address{nnn, Address::Truncate{}};
-    auto const target = base+(config_.use_vx_for_offset_jump ? v_[x] : v_[0]);
+    auto const target = base+(quirks_.use_vx_for_offset_jump ? v_[x] : v_[0]);
 
-    std::ostringstream msg;
-    msg << "Jumping to 0x"
-        << std::setfill('0') << std::setw(3) << std::hex << static_cast<std::uint16_t>(target);
-    logger_.debug(msg.str().c_str());
+    if (logger_.debug_enabled()) {
+      std::ostringstream msg;
+      msg << "Jumping to 0x"
+          << std::setfill('0') << std::setw(3) << std::hex << static_cast<std::uint16_t>(target);
+      logger_.debug(msg.str().c_str());
+    }
     pc_ = target;
   }
+
+  template class BasicProcessor<Config>;
+  template class BasicProcessor<quirks::Cosmac>;
+  template class BasicProcessor<quirks::Chip48>;
+  template class BasicProcessor<quirks::SuperChip>;
 }
@@ -4,19 +4,194 @@
 #define CHIP8_VM_PROCESSOR_HXX
 
 #include <atomic>
+#include <bitset>
+#include <chrono>
+#include <concepts>
 #include <cstdint>
 #include <random>
+#include <type_traits>
 
+#include "audio.hxx"
 #include "call_stack.hxx"
+#include "hash.hxx"
+#include "input_latency.hxx"
 #include "logger.hxx"
 #include "memory.hxx"
+#include "metrics.hxx"
+#include "ring_buffer.hxx"
 #include "screen.hxx"
 
 namespace chip8 {
+  /**
+   * Time an instruction takes at normal speed, ~700 instructions per millisecond.
+   */
+  std::chrono::nanoseconds constexpr INSTRUCTION_TIME{1'428};
+
+  /**
+   * Number of instructions executed per second at normal speed.
+   */
+  std::uint64_t constexpr CYCLES_PER_SECOND = static_cast<std::uint64_t>(std::chrono::seconds{1}/INSTRUCTION_TIME);
+
+  /**
+   * Number of instructions between two ticks of the 60 Hz timers. Every frontend and Machine tick at the same cycles,
+   * so their runs can be compared tick for tick.
+   */
+  std::uint64_t constexpr CYCLES_PER_TIMER_TICK = CYCLES_PER_SECOND/60u;
+
+  /**
+   * Quirks of the different CHIP-8 implementations, selectable at runtime.
+   */
   struct Config final {
     bool register_rw_modifies_i;
     bool shift_takes_value_from_vy;
     bool use_vx_for_offset_jump;
+    bool supports_high_resolution;
+  };
+
+  /**
+   * Quirk profiles known at compile time.
+   *
+   * A processor instantiated with one of these has its quirk checks folded away by the compiler.
+   */
+  namespace quirks {
+    /**
+     * The original COSMAC VIP interpreter.
+     */
+    struct Cosmac final {
+      static bool constexpr register_rw_modifies_i = true;
+      static bool constexpr shift_takes_value_from_vy = true;
+      static bool constexpr use_vx_for_offset_jump = false;
+      static bool constexpr supports_high_resolution = false;
+    };
+
+    /**
+     * The CHIP-48 interpreter for the HP-48 calculators.
+     */
+    struct Chip48 final {
+      static bool constexpr register_rw_modifies_i = false;
+      static bool constexpr shift_takes_value_from_vy = false;
+      static bool constexpr use_vx_for_offset_jump = true;
+      static bool constexpr supports_high_resolution = false;
+    };
+
+    /**
+     * SUPER-CHIP 1.1, which inherited its quirks from CHIP-48 and added the high resolution and scrolling.
+     */
+    struct SuperChip final {
+      static bool constexpr register_rw_modifies_i = false;
+      static bool constexpr shift_takes_value_from_vy = false;
+      static bool constexpr use_vx_for_offset_jump = true;
+      static bool constexpr supports_high_resolution = true;
+    };
+  }
+
+  template<typename T>
+  concept QuirkSet = requires(T const& quirks) {
+    { quirks.register_rw_modifies_i } -> std::convertible_to<bool>;
+    { quirks.shift_takes_value_from_vy } -> std::convertible_to<bool>;
+    { quirks.use_vx_for_offset_jump } -> std::convertible_to<bool>;
+    { quirks.supports_high_resolution } -> std::convertible_to<bool>;
+  };
+
+  enum class QuirkProfile {
+    Cosmac,
+    Chip48,
+    SuperChip,
+  };
+
+  /**
+   * Select the compile time quirk set for a profile chosen at runtime.
+   *
+   * @param profile The profile to select.
+   * @param fn Callable being invoked with a std::type_identity of the matching quirk set.
+   * @return Whatever fn returns.
+   */
+  template<typename Fn>
+  decltype(auto) with_quirk_profile(QuirkProfile const profile, Fn&& fn)
+  {
+    switch (profile) {
+    default:
+    case QuirkProfile::Cosmac:
+      return std::forward<Fn>(fn)(std::type_identity<quirks::Cosmac>{});
+    case QuirkProfile::Chip48:
+      return std::forward<Fn>(fn)(std::type_identity<quirks::Chip48>{});
+    case QuirkProfile::SuperChip:
+      return std::forward<Fn>(fn)(std::type_identity<quirks::SuperChip>{});
+    }
+  }
+
+  class TraceWriter;
+
+  /**
+   * A key being pressed or released, on its way from the frontend to the processor.
+   */
+  struct KeyEvent final {
+    std::uint8_t key;
+    bool pressed;
+    /**
+     * Time the frontend queued the event at, in nanoseconds of std::chrono::steady_clock.
+     */
+    std::uint64_t queued_at;
+    /**
+     * The processor cycle at which the event was applied.
+     */
+    std::uint64_t applied_cycle;
+  };
+
+  /**
+   * The reason run() or run_until() returned.
+   */
+  enum class StopReason {
+    /**
+     * All requested cycles were executed.
+     */
+    BudgetExhausted,
+    /**
+     * The last instruction changed the screen, only reported when requested through StopOn.
+     */
+    Draw,
+    /**
+     * The last instruction is waiting for a key, only reported when requested through StopOn.
+     */
+    WaitingForKey,
+    UnsupportedInstruction,
+    /**
+     * A return without a matching call.
+     */
+    StackUnderflow,
+    /**
+     * A call with CallStack::CAPACITY calls already on the call stack.
+     */
+    StackOverflow,
+    /**
+     * The next instruction is at a breakpoint.
+     */
+    Breakpoint,
+  };
+
+  /**
+   * Events which end run() and run_until() early in addition to errors and breakpoints.
+   */
+  struct StopOn final {
+    bool draw{false};
+    bool waiting_for_key{false};
+  };
+
+  struct RunResult final {
+    StopReason reason;
+    /**
+     * The number of instructions executed, including the one halting the processor.
+     */
+    std::uint64_t cycles;
+    /**
+     * The address of the instruction causing the stop, or of the next one if the budget is exhausted
+     * or a breakpoint was hit.
+     */
+    Address pc;
+    /**
+     * The instruction at pc.
+     */
+    std::uint16_t opcode;
   };
 
   enum class GetKeyState {
@@ -25,30 +200,206 @@ namespace chip8 {
     GotKey,
   };
 
-  class Processor final {
+  /**
+   * Everything the processor keeps track of itself.
+   *
+   * Memory, screen and call stack are not part of it, they belong to whoever owns the processor.
+   * Key events which are still queued are not part of it either.
+   */
+  struct ProcessorState final {
+    Address pc{};
+    Address i{};
+    std::uint8_t delay_timer{0u};
+    std::uint8_t sound_timer{0u};
+    std::array<std::uint8_t, 16u> v{};
+    std::uint64_t cycles{0u};
+    bool beeping{false};
+    std::uint16_t keys{0u};
+    GetKeyState get_key_state{GetKeyState::None};
+    std::uint8_t last_key{0u};
+    std::mt19937 rng{};
+
+    bool operator==(ProcessorState const&) const = default;
+
+    /**
+     * Get a hash of the registers.
+     *
+     * The random number generator is left out, differences in it show up in the registers soon enough.
+     *
+     * @return The hash of the state.
+     */
+    [[nodiscard]] std::uint64_t digest() const noexcept
+    {
+      auto hash = hash_combine(static_cast<std::uint16_t>(pc), static_cast<std::uint16_t>(i));
+      hash = hash_combine(hash, (delay_timer << 8) | sound_timer);
+      for (auto const value: v)
+        hash = hash_combine(hash, value);
+      hash = hash_combine(hash, cycles);
+      hash = hash_combine(hash, (static_cast<std::uint64_t>(keys) << 16) | (static_cast<unsigned>(get_key_state) << 8)
+          | last_key);
+      return hash_combine(hash, beeping);
+    }
+  };
+
+  /**
+   * The CHIP-8 interpreter.
+   *
+   * @tparam Quirks Either Config for quirks chosen at runtime or one of the compile time profiles in chip8::quirks.
+   */
+  template<QuirkSet Quirks>
+  class BasicProcessor final {
   public:
     static constexpr Address const CODE_START = 0x200_addr;
     static constexpr Address const FONT_START = 0x050_addr;
+    /**
+     * Queued key events are applied every INPUT_BATCH cycles. Must be a power of two.
+     */
+    static constexpr std::uint64_t const INPUT_BATCH = 64u;
+    static constexpr std::size_t const KEY_EVENT_CAPACITY = 256u;
 
-    Processor(Config const& config, CallStack& call_stack, Memory& memory, Screen& screen, Logger& logger) noexcept;
+    BasicProcessor(Quirks const& quirks, CallStack& call_stack, Memory& memory, Screen& screen, Audio& audio,
+        Logger& logger) noexcept;
 
-    Processor(Processor const&) = delete;
+    BasicProcessor(BasicProcessor const&) = delete;
 
-    Processor& operator=(Processor const&) = delete;
+    BasicProcessor& operator=(BasicProcessor const&) = delete;
 
     bool step();
 
+    /**
+     * Execute instructions in a tight loop until the budget is exhausted or the processor stops.
+     *
+     * Timers are not updated, callers run until the next timer tick and call update_timers() themselves.
+     *
+     * @param max_cycles The maximum number of instructions to execute.
+     * @param stop_on The events to stop at besides errors and breakpoints.
+     * @return Why the processor stopped and how many instructions it executed.
+     */
+    RunResult run(std::uint64_t max_cycles, StopOn stop_on = {});
+
+    /**
+     * Execute instructions until cycles() reaches the given value or the processor stops.
+     *
+     * Hosts pass the cycle of the next frame boundary, so they only call into the processor once per frame.
+     *
+     * @param cycle The cycle to stop at.
+     * @param stop_on The events to stop at besides errors and breakpoints.
+     * @return Why the processor stopped and how many instructions it executed.
+     */
+    RunResult run_until(std::uint64_t cycle, StopOn stop_on = {});
+
+    /**
+     * Stop run() and run_until() before executing the instruction at the given address.
+     *
+     * The first instruction of a run is executed even if it is at a breakpoint, so runs can continue from it.
+     *
+     * @param address The address of the instruction.
+     */
+    void set_breakpoint(Address address);
+
+    void clear_breakpoint(Address address);
+
+    void clear_breakpoints() noexcept;
+
     void update_timers();
 
-    void toggle_key(std::uint8_t index, bool pressed);
+    /**
+     * Queue a key press or release.
+     *
+     * The processor applies queued events between instructions, at the latest after INPUT_BATCH cycles.
+     * Must always be called from the same thread, which does not need to be the one running the processor.
+     *
+     * @param index The key (0x0-0xF).
+     * @param pressed true, if the key was pressed, false if it was released.
+     * @return true, if the event was queued, false if the key is invalid or the queue is full.
+     */
+    bool toggle_key(std::uint8_t index, bool pressed);
+
+    /**
+     * Apply all queued key events immediately. Must be called from the thread running the processor.
+     */
+    void process_input();
+
+    /**
+     * Get the next key event the processor applied, to measure input latency.
+     *
+     * Must always be called from the same thread. Events are dropped when they are not fetched.
+     *
+     * @return The applied event or an empty optional if no event was applied since the last call.
+     */
+    std::optional<KeyEvent> applied_input();
+
+    /**
+     * Get the number of instructions executed so far.
+     *
+     * @return The number of executed instructions.
+     */
+    [[nodiscard]] std::uint64_t cycles() const noexcept;
+
+    /**
+     * Get the address of the next instruction.
+     *
+     * @return The program counter.
+     */
+    [[nodiscard]] Address pc() const noexcept;
+
+    /**
+     * Seed the random number generator, to make runs reproducible.
+     *
+     * Processors are seeded from std::random_device unless this is called.
+     *
+     * @param seed The seed to use.
+     */
+    void seed(std::uint32_t seed);
+
+    /**
+     * Take a snapshot of the processor state.
+     *
+     * @return The current state.
+     */
+    [[nodiscard]] ProcessorState state() const;
+
+    /**
+     * Continue from a previously taken snapshot.
+     *
+     * Key events which are still queued are dropped. Must be called from the thread running the processor.
+     *
+     * @param state The state to restore.
+     */
+    void restore(ProcessorState const& state);
+
+    /**
+     * Record every executed instruction to a trace.
+     *
+     * @param tracer The trace to record to or nullptr to stop tracing.
+     */
+    void set_tracer(TraceWriter* tracer) noexcept;
+
+    /**
+     * Report the time spent drawing sprites.
+     *
+     * @param metrics The metrics to report to or nullptr to stop reporting.
+     */
+    void set_metrics(EmulatorMetrics* metrics) noexcept;
+
+    /**
+     * Follow applied key events through the instructions reading the keys to the next sprite being drawn.
+     *
+     * @param tracer The tracer to report to or nullptr to stop tracing.
+     */
+    void set_latency_tracer(InputLatencyTracer* tracer) noexcept;
 
   private:
     // dependencies
-    Config config_;
+    [[no_unique_address]] Quirks quirks_;
     CallStack& call_stack_;
     Memory& memory_;
     Screen& screen_;
+    Audio& audio_;
     Logger& logger_;
+    TraceWriter* tracer_{nullptr};
+    EmulatorMetrics* metrics_{nullptr};
+    InputLatencyTracer* latency_tracer_{nullptr};
 
     std::mt19937 rng_{std::random_device{}()};
     std::uniform_int_distribution<std::uint16_t> dist_{0, 0xFF};
@@ -57,18 +408,42 @@ namespace chip8 {
     Address pc_{0x200};
     Address i_{0x0};
     std::atomic<std::uint8_t> delay_timer_{0u};
-    // std::atomic<std::uint8_t> sound_timer_{0u};
+    std::atomic<std::uint8_t> sound_timer_{0u};
     std::array<std::uint8_t, 16u> v_{};
-
-    std::atomic<std::uint16_t> keys_{0u};
+    std::uint64_t cycles_{0u};
+    bool beeping_{false};
+
+    // debugging, breakpoints are only looked up while there are any
+    std::bitset<Memory::SIZE> breakpoints_{};
+    bool has_breakpoints_{false};
+    /**
+     * Why the last failing instruction failed, for run() to report.
+     */
+    StopReason fault_{StopReason::UnsupportedInstruction};
+    bool drew_{false};
+
+    // input, the key state is only touched by the thread running the processor
+    RingBuffer<KeyEvent, KEY_EVENT_CAPACITY> key_events_{};
+    RingBuffer<KeyEvent, KEY_EVENT_CAPACITY> applied_key_events_{};
+    std::uint16_t keys_{0u};
     GetKeyState get_key_state_ = GetKeyState::None;
     std::uint8_t last_key_{0};
 
+    void apply_key(KeyEvent event);
+
+    bool execute();
+
+    bool traced_step();
+
+    [[nodiscard]] RunResult stopped(StopReason reason, std::uint64_t start, Address pc) const;
+
     bool native_instruction(std::uint16_t param);
 
+    bool high_resolution_instruction(std::uint16_t param);
+
     void jump(std::uint16_t param);
 
-    void call(std::uint16_t param);
+    bool call(std::uint16_t param);
 
     void set_register(std::uint8_t index, std::uint8_t value);
 
@@ -80,6 +455,14 @@ namespace chip8 {
 
     void draw(std::uint8_t x_register, std::uint8_t y_register, std::uint8_t sprite_size);
 
+    void scroll_down(std::uint8_t rows);
+
+    void scroll_left();
+
+    void scroll_right();
+
+    void set_high_resolution(bool enabled);
+
     bool register_instruction(std::uint8_t index, std::uint16_t instruction);
 
     void store_to_memory(std::uint8_t index);
@@ -90,6 +473,8 @@ namespace chip8 {
 
     void set_delay_timer(std::uint8_t index);
 
+    void set_sound_timer(std::uint8_t index);
+
     void skip_if_equal_to(std::uint8_t index, std::uint8_t value);
 
     void skip_unless_equal_to(std::uint8_t index, std::uint8_t value);
@@ -134,6 +519,13 @@ namespace chip8 {
 
     void jump_with_offset(std::uint8_t const x, std::uint16_t const nnn);
   };
+
+  using Processor = BasicProcessor<Config>;
+
+  extern template class BasicProcessor<Config>;
+  extern template class BasicProcessor<quirks::Cosmac>;
+  extern template class BasicProcessor<quirks::Chip48>;
+  extern template class BasicProcessor<quirks::SuperChip>;
 }
 
 #endif // CHIP8_VM_PROCESSOR_HXX
@@ -0,0 +1,101 @@
+#pragma once
+
+#ifndef CHIP8_VM_RING_BUFFER_HXX
+#define CHIP8_VM_RING_BUFFER_HXX
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+
+namespace chip8 {
+  /**
+   * Bounded lock-free queue for exactly one producer and one consumer thread.
+   *
+   * Neither side ever blocks or allocates, which makes it usable from real-time threads like audio callbacks.
+   *
+   * @tparam T The element type.
+   * @tparam Capacity The maximum number of queued elements. Must be a power of two.
+   */
+  template<typename T, std::size_t Capacity>
+  class RingBuffer final {
+    static_assert(Capacity>0u && (Capacity & (Capacity-1u))==0u, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "Elements must be trivially copyable");
+
+  public:
+    /**
+     * Append an element. Must only be called from the producer thread.
+     *
+     * @param value The element to append.
+     * @return true, if the element was queued, false if the queue is full.
+     */
+    bool push(T const& value) noexcept
+    {
+      auto const tail = tail_.load(std::memory_order_relaxed);
+      if (tail-cached_head_==Capacity) {
+        cached_head_ = head_.load(std::memory_order_acquire);
+        if (tail-cached_head_==Capacity)
+          return false;
+      }
+
+      elements_[tail & (Capacity-1u)] = value;
+      tail_.store(tail+1u, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * Get the oldest element without removing it. Must only be called from the consumer thread.
+     *
+     * @return Pointer to the oldest element or nullptr if the queue is empty.
+     */
+    T const* front() noexcept
+    {
+      auto const head = head_.load(std::memory_order_relaxed);
+      if (head==cached_tail_) {
+        cached_tail_ = tail_.load(std::memory_order_acquire);
+        if (head==cached_tail_)
+          return nullptr;
+      }
+      return &elements_[head & (Capacity-1u)];
+    }
+
+    /**
+     * Remove and return the oldest element. Must only be called from the consumer thread.
+     *
+     * @return The oldest element or an empty optional if the queue is empty.
+     */
+    std::optional<T> pop() noexcept
+    {
+      auto const element = front();
+      if (element==nullptr)
+        return {};
+
+      T result = *element;
+      head_.store(head_.load(std::memory_order_relaxed)+1u, std::memory_order_release);
+      return result;
+    }
+
+    /**
+     * Check whether the queue is empty.
+     *
+     * The result is only a snapshot when called concurrently to push() or pop().
+     *
+     * @return true, if the queue is empty, false otherwise.
+     */
+    [[nodiscard]] bool empty() const noexcept
+    {
+      return head_.load(std::memory_order_acquire)==tail_.load(std::memory_order_acquire);
+    }
+
+  private:
+    // head and tail live on separate cache lines so producer and consumer do not contend
+    alignas(64) std::atomic<std::size_t> head_{0u};
+    std::size_t cached_tail_{0u};
+    alignas(64) std::atomic<std::size_t> tail_{0u};
+    std::size_t cached_head_{0u};
+    alignas(64) std::array<T, Capacity> elements_{};
+  };
+}
+
+#endif // CHIP8_VM_RING_BUFFER_HXX
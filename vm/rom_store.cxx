@@ -0,0 +1,220 @@
+#include "rom_store.hxx"
+#include "hash.hxx"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace chip8 {
+  namespace {
+    /**
+     * Check whether an instruction only exists on SUPER-CHIP.
+     */
+    bool is_super_chip(std::uint16_t const opcode) noexcept
+    {
+      switch (opcode & 0xF0FFu) {
+      default:
+        break;
+      case 0xF030u: // large font character
+      case 0xF075u: // store flags
+      case 0xF085u: // load flags
+        return true;
+      }
+      return opcode==0x00FBu || opcode==0x00FCu || opcode==0x00FDu || opcode==0x00FEu || opcode==0x00FFu
+          || (opcode & 0xFFF0u)==0x00C0u;
+    }
+
+    /**
+     * Check whether a program executes instructions only SUPER-CHIP understands.
+     *
+     * Programs mix code with sprites and other data, so only the instructions reachable from the start of the code
+     * are looked at, following jumps, calls and both outcomes of skips. Computed jumps (BNNN) cannot be followed.
+     */
+    bool uses_super_chip(std::span<std::uint8_t const> const bytes) noexcept
+    {
+      auto constexpr START = static_cast<std::uint16_t>(Processor::CODE_START);
+      std::vector<bool> visited(bytes.size(), false);
+      std::vector<std::size_t> pending{0u};
+      auto const follow = [&](std::uint16_t const address) {
+        auto const offset = static_cast<std::size_t>(address-START);
+        if (address>=START && offset<bytes.size())
+          pending.push_back(offset);
+      };
+
+      while (!pending.empty()) {
+        auto const offset = pending.back();
+        pending.pop_back();
+        if (offset+1u>=bytes.size() || visited[offset])
+          continue;
+        visited[offset] = true;
+
+        auto const opcode = static_cast<std::uint16_t>((bytes[offset] << 8) | bytes[offset+1u]);
+        if (is_super_chip(opcode))
+          return true;
+
+        auto const address = static_cast<std::uint16_t>(START+offset);
+        auto const target = static_cast<std::uint16_t>(opcode & 0x0FFFu);
+        switch (opcode >> 12) {
+        default:
+          if (opcode!=0x00EEu)
+            follow(address+2u);
+          break;
+        case 0x1u:
+          follow(target);
+          break;
+        case 0x2u:
+          follow(target);
+          follow(address+2u);
+          break;
+        case 0x3u:
+        case 0x4u:
+        case 0x5u:
+        case 0x9u:
+          follow(address+2u);
+          follow(address+4u);
+          break;
+        case 0xBu:
+          break;
+        case 0xEu:
+          follow(address+2u);
+          if ((opcode & 0xFFu)==0x9Eu || (opcode & 0xFFu)==0xA1u)
+            follow(address+4u);
+          break;
+        }
+      }
+      return false;
+    }
+  }
+
+  Rom::Rom(std::filesystem::path const& path)
+  {
+#ifdef _WIN32
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+      throw RomException{"Could not open ROM " + path.string()};
+    buffer_.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+    bytes_ = buffer_;
+#else
+    auto const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd<0)
+      throw RomException{"Could not open ROM " + path.string()};
+
+    struct stat info{};
+    if (fstat(fd, &info)!=0 || !S_ISREG(info.st_mode)) {
+      ::close(fd);
+      throw RomException{"Could not open ROM " + path.string()};
+    }
+
+    auto const size = static_cast<std::size_t>(info.st_size);
+    if (size>0u && size<=MAX_SIZE) {
+      auto const memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (memory==MAP_FAILED) {
+        ::close(fd);
+        throw RomException{"Could not map ROM " + path.string()};
+      }
+      mapping_ = memory;
+      bytes_ = std::span{static_cast<std::uint8_t const*>(memory), size};
+    }
+    ::close(fd);
+    if (size>MAX_SIZE)
+      throw RomException{"ROM " + path.string() + " does not fit in memory"};
+#endif
+
+    if (bytes_.empty())
+      throw RomException{"ROM " + path.string() + " is empty"};
+    if (bytes_.size()>MAX_SIZE)
+      throw RomException{"ROM " + path.string() + " does not fit in memory"};
+
+    hash_ = fnv1a64(bytes_);
+    quirk_profile_ = uses_super_chip(bytes_) ? QuirkProfile::SuperChip : QuirkProfile::Cosmac;
+  }
+
+  Rom::~Rom() noexcept
+  {
+#ifndef _WIN32
+    if (mapping_!=nullptr)
+      munmap(mapping_, bytes_.size());
+#endif
+  }
+
+  std::span<std::uint8_t const> Rom::bytes() const noexcept
+  {
+    return bytes_;
+  }
+
+  std::uint64_t Rom::hash() const noexcept
+  {
+    return hash_;
+  }
+
+  QuirkProfile Rom::quirk_profile() const noexcept
+  {
+    return quirk_profile_;
+  }
+
+  std::shared_ptr<Rom const> RomStore::open(std::filesystem::path const& path)
+  {
+    std::error_code error{};
+    auto const key = std::filesystem::absolute(path, error).lexically_normal().string();
+    auto const size = std::filesystem::file_size(path, error);
+    auto const modified = error ? std::filesystem::file_time_type{} : std::filesystem::last_write_time(path, error);
+    if (error)
+      throw RomException{"Could not open ROM " + path.string()};
+
+    std::lock_guard lock{mutex_};
+    auto const file = files_.find(key);
+    if (file!=files_.end() && file->second.size==size && file->second.modified==modified)
+      return file->second.rom;
+
+    // the constructor is private, so std::make_shared cannot be used
+    auto rom = share(std::shared_ptr<Rom const>{new Rom{path}});
+    if (file!=files_.end()) {
+      drop(file->second.rom);
+      file->second = FileEntry{.size = size, .modified = modified, .rom = rom};
+    }
+    else {
+      files_.emplace(key, FileEntry{.size = size, .modified = modified, .rom = rom});
+    }
+    return rom;
+  }
+
+  std::shared_ptr<Rom const> RomStore::share(std::shared_ptr<Rom const> rom)
+  {
+    // another file with the same content might have been opened before, its image is reused then
+    auto const [first, last] = images_.equal_range(rom->hash());
+    for (auto image = first; image!=last; ++image) {
+      auto const bytes = image->second.rom->bytes();
+      if (bytes.size()==rom->bytes().size() && std::ranges::equal(bytes, rom->bytes())) {
+        ++image->second.files;
+        return image->second.rom;
+      }
+    }
+    return images_.emplace(rom->hash(), Image{.rom = rom, .files = 1u})->second.rom;
+  }
+
+  void RomStore::drop(std::shared_ptr<Rom const> const& rom) noexcept
+  {
+    auto const [first, last] = images_.equal_range(rom->hash());
+    for (auto image = first; image!=last; ++image) {
+      if (image->second.rom==rom) {
+        if (--image->second.files==0u)
+          images_.erase(image);
+        return;
+      }
+    }
+  }
+
+  std::size_t RomStore::size() const
+  {
+    std::lock_guard lock{mutex_};
+    return images_.size();
+  }
+}
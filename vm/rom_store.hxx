@@ -0,0 +1,133 @@
+#pragma once
+
+#ifndef CHIP8_VM_ROM_STORE_HXX
+#define CHIP8_VM_ROM_STORE_HXX
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "processor.hxx"
+
+namespace chip8 {
+  /**
+   * Exception class being thrown when a ROM cannot be opened.
+   *
+   * Even though the class has the same functionality as its base,
+   * it exists for improved readability as it is more specific.
+   */
+  class RomException final : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+    using std::runtime_error::operator=;
+  };
+
+  /**
+   * Read-only image of a ROM, shared by all sessions running it.
+   *
+   * Besides the content it carries everything derived from it, so it is only analysed once.
+   */
+  class Rom final {
+  public:
+    /**
+     * The largest ROM fitting between the start of the code and the end of memory.
+     */
+    static std::size_t constexpr MAX_SIZE = 0x1000u-static_cast<std::uint16_t>(Processor::CODE_START);
+
+    Rom(Rom const&) = delete;
+
+    Rom& operator=(Rom const&) = delete;
+
+    ~Rom() noexcept;
+
+    [[nodiscard]] std::span<std::uint8_t const> bytes() const noexcept;
+
+    /**
+     * Get the FNV-1a hash identifying the content.
+     *
+     * @return The hash of the ROM.
+     */
+    [[nodiscard]] std::uint64_t hash() const noexcept;
+
+    /**
+     * Get the quirk profile the ROM was most likely written for.
+     *
+     * ROMs executing SUPER-CHIP instructions are detected as such, everything else is assumed to target the COSMAC VIP.
+     * Only instructions reachable from the start of the code count, so sprites and other data are not mistaken for them.
+     *
+     * @return The detected quirk profile.
+     */
+    [[nodiscard]] QuirkProfile quirk_profile() const noexcept;
+
+  private:
+    friend class RomStore;
+
+    void* mapping_{nullptr};
+    std::vector<std::uint8_t> buffer_{};
+    std::span<std::uint8_t const> bytes_{};
+    std::uint64_t hash_{0u};
+    QuirkProfile quirk_profile_{QuirkProfile::Cosmac};
+
+    explicit Rom(std::filesystem::path const& path);
+  };
+
+  /**
+   * Hands out ROM images by file, mapping every file only once.
+   *
+   * Images are identified by their content, so copies of the same ROM share a single image.
+   * A file is only mapped again when its size or modification time changed. Like shared libraries, ROM files
+   * must be replaced instead of being rewritten in place while their images are in use. The store lets go of an
+   * image once no file has it anymore, sessions still using it keep it alive. Thread safe.
+   */
+  class RomStore final {
+  public:
+    /**
+     * Get the image of a ROM file.
+     *
+     * @param path The ROM file.
+     * @return The shared image of the ROM.
+     * @throws RomException if the file cannot be read, is empty or does not fit in memory.
+     */
+    std::shared_ptr<Rom const> open(std::filesystem::path const& path);
+
+    /**
+     * Get the number of distinct ROM images the opened files have.
+     *
+     * @return The number of images.
+     */
+    [[nodiscard]] std::size_t size() const;
+
+  private:
+    struct FileEntry final {
+      std::uintmax_t size;
+      std::filesystem::file_time_type modified;
+      std::shared_ptr<Rom const> rom;
+    };
+
+    struct Image final {
+      std::shared_ptr<Rom const> rom;
+      /**
+       * The number of files having the image.
+       */
+      std::size_t files;
+    };
+
+    mutable std::mutex mutex_{};
+    std::unordered_map<std::string, FileEntry> files_{};
+    /**
+     * Images by the hash of their content. Different contents with the same hash get an image each.
+     */
+    std::unordered_multimap<std::uint64_t, Image> images_{};
+
+    std::shared_ptr<Rom const> share(std::shared_ptr<Rom const> rom);
+
+    void drop(std::shared_ptr<Rom const> const& rom) noexcept;
+  };
+}
+
+#endif // CHIP8_VM_ROM_STORE_HXX
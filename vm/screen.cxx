@@ -0,0 +1,52 @@
+#include "screen.hxx"
+
+namespace chip8 {
+  bool Screen::draw_sprite(std::uint8_t const x, std::uint8_t const y, std::span<std::uint16_t const> const rows)
+  {
+    auto const width = this->width();
+    auto const height = this->height();
+    bool collision = false;
+    for (std::size_t n = 0; n<rows.size() && y+n<height; ++n) {
+      auto const row = static_cast<std::uint8_t>(y+n);
+      for (std::uint8_t bit = 0; bit<16u && x+bit<width; ++bit) {
+        if ((rows[n] & (0x8000u >> bit))==0u)
+          continue;
+
+        auto const column = static_cast<std::uint8_t>(x+bit);
+        if (get_pixel(column, row)) {
+          collision = true;
+          set_pixel(column, row, false);
+        }
+        else
+          set_pixel(column, row, true);
+      }
+    }
+    return collision;
+  }
+
+  void Screen::scroll_down(std::uint8_t const rows)
+  {
+    auto const width = this->width();
+    for (auto y = height(); y--;) {
+      for (std::uint8_t x = 0; x<width; ++x)
+        set_pixel(x, y, y>=rows && get_pixel(x, static_cast<std::uint8_t>(y-rows)));
+    }
+  }
+
+  void Screen::scroll_left()
+  {
+    auto const width = this->width();
+    for (std::uint8_t y = 0; y<height(); ++y) {
+      for (std::uint8_t x = 0; x<width; ++x)
+        set_pixel(x, y, x+SCROLL_STEP<width && get_pixel(static_cast<std::uint8_t>(x+SCROLL_STEP), y));
+    }
+  }
+
+  void Screen::scroll_right()
+  {
+    for (std::uint8_t y = 0; y<height(); ++y) {
+      for (auto x = width(); x--;)
+        set_pixel(x, y, x>=SCROLL_STEP && get_pixel(static_cast<std::uint8_t>(x-SCROLL_STEP), y));
+    }
+  }
+}
@@ -4,16 +4,25 @@
 #define CHIP8_VM_SCREEN_HXX
 
 #include <cstdint>
+#include <span>
 
 namespace chip8 {
   /**
    * Interface representing a screen.
    *
    * This needs to be implemented by specific frontends.
+   * Screens start out in the low resolution of CHIP-8, SUPER-CHIP programs can switch to the high resolution.
+   * All coordinates are given in the current resolution.
    */
   struct Screen {
     static std::uint8_t constexpr WIDTH = 64;
     static std::uint8_t constexpr HEIGHT = 32;
+    static std::uint8_t constexpr HIRES_WIDTH = 128;
+    static std::uint8_t constexpr HIRES_HEIGHT = 64;
+    /**
+     * Number of pixels scroll_left() and scroll_right() move the screen by.
+     */
+    static std::uint8_t constexpr SCROLL_STEP = 4;
 
     virtual ~Screen() noexcept = default;
 
@@ -32,6 +41,54 @@ namespace chip8 {
     virtual bool get_pixel(std::uint8_t x, std::uint8_t y) = 0;
 
     virtual void set_pixel(std::uint8_t x, std::uint8_t y, bool state) = 0;
+
+    /**
+     * Switch between the low and the high resolution. The screen is cleared in the process.
+     *
+     * @param enabled true for the high resolution, false for the low resolution.
+     */
+    virtual void set_high_resolution(bool enabled) = 0;
+
+    [[nodiscard]] virtual bool high_resolution() const = 0;
+
+    [[nodiscard]] std::uint8_t width() const
+    {
+      return high_resolution() ? HIRES_WIDTH : WIDTH;
+    }
+
+    [[nodiscard]] std::uint8_t height() const
+    {
+      return high_resolution() ? HIRES_HEIGHT : HEIGHT;
+    }
+
+    /**
+     * XOR a sprite onto the screen. Parts of the sprite outside the screen are clipped.
+     *
+     * The default implementation draws pixel by pixel, screens with a faster way override it.
+     *
+     * @param x The x coordinate of the top left corner. Must be on the screen.
+     * @param y The y coordinate of the top left corner. Must be on the screen.
+     * @param rows The rows of the sprite, up to 16 pixels wide with the leftmost pixel in the most significant bit.
+     * @return true, if any pixel was turned off, false otherwise.
+     */
+    virtual bool draw_sprite(std::uint8_t x, std::uint8_t y, std::span<std::uint16_t const> rows);
+
+    /**
+     * Move the whole screen down, the rows at the top become empty.
+     *
+     * @param rows The number of rows to move the screen by.
+     */
+    virtual void scroll_down(std::uint8_t rows);
+
+    /**
+     * Move the whole screen SCROLL_STEP pixels to the left, the columns at the right become empty.
+     */
+    virtual void scroll_left();
+
+    /**
+     * Move the whole screen SCROLL_STEP pixels to the right, the columns at the left become empty.
+     */
+    virtual void scroll_right();
   };
 }
 
@@ -0,0 +1,70 @@
+#include "shared_frame.hxx"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace chip8 {
+  namespace {
+    // a reader giving up after this many attempts lets the caller decide when to try again
+    int constexpr MAX_READ_ATTEMPTS = 64;
+  }
+
+  SharedFrameReader::SharedFrameReader(std::string const& name)
+  {
+    auto const fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd<0)
+      throw SharedMemoryException{"Could not open shared memory segment"};
+
+    auto const memory = mmap(nullptr, sizeof(SharedFrame), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory==MAP_FAILED)
+      throw SharedMemoryException{"Could not map shared memory segment"};
+
+    frame_ = static_cast<SharedFrame*>(memory);
+    if (frame_->magic!=SharedFrame::MAGIC || frame_->version!=SharedFrame::VERSION) {
+      munmap(frame_, sizeof(SharedFrame));
+      throw SharedMemoryException{"Shared memory segment has an unknown layout"};
+    }
+  }
+
+  SharedFrameReader::~SharedFrameReader() noexcept
+  {
+    munmap(frame_, sizeof(SharedFrame));
+  }
+
+  std::optional<SharedFrameReader::Frame> SharedFrameReader::read() const noexcept
+  {
+    Frame result{};
+    for (int attempt = 0; attempt<MAX_READ_ATTEMPTS; ++attempt) {
+      auto const before = frame_->sequence.load(std::memory_order_acquire);
+      if (before & 1u)
+        continue;
+
+      result.number = frame_->frame.load(std::memory_order_relaxed);
+      result.width = frame_->frame_width.load(std::memory_order_relaxed);
+      result.height = frame_->frame_height.load(std::memory_order_relaxed);
+      for (std::size_t y = 0; y<result.rows.size(); ++y) {
+        for (std::size_t n = 0; n<result.rows[y].size(); ++n)
+          result.rows[y][n] = frame_->rows[y][n].load(std::memory_order_relaxed);
+      }
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (frame_->sequence.load(std::memory_order_relaxed)==before)
+        return result;
+    }
+    return {};
+  }
+
+  void SharedFrameReader::set_key(std::uint8_t const index, bool const pressed) noexcept
+  {
+    if (index>0xF)
+      return;
+
+    auto const mask = static_cast<std::uint16_t>(1u << index);
+    if (pressed)
+      frame_->keys.fetch_or(mask, std::memory_order_release);
+    else
+      frame_->keys.fetch_and(static_cast<std::uint16_t>(~mask), std::memory_order_release);
+  }
+}
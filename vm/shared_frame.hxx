@@ -0,0 +1,116 @@
+#pragma once
+
+#ifndef CHIP8_VM_SHARED_FRAME_HXX
+#define CHIP8_VM_SHARED_FRAME_HXX
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+namespace chip8 {
+  /**
+   * Exception class being thrown when a shared memory segment cannot be created or opened.
+   *
+   * Even though the class has the same functionality as its base,
+   * it exists for improved readability as it is more specific.
+   */
+  class SharedMemoryException final : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+    using std::runtime_error::operator=;
+  };
+
+  /**
+   * Layout of the POSIX shared memory segment a running VM exports its frames through.
+   *
+   * Frames are only written by the thread running the processor, between instructions, guarded by a sequence lock:
+   * the sequence is odd while a frame is written, readers retry if it was odd or changed while they were reading.
+   * Consumers report pressed keys through the key bitmask, which the VM forwards to the processor.
+   * The segment is sized for the high resolution, frames in the low resolution only use its top left corner.
+   */
+  struct SharedFrame final {
+    static std::uint32_t constexpr MAGIC = 0x42463843u; // "C8FB"
+    static std::uint32_t constexpr VERSION = 2u;
+    static std::uint16_t constexpr WIDTH = 128u;
+    static std::uint16_t constexpr HEIGHT = 64u;
+
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint16_t width;
+    std::uint16_t height;
+
+    alignas(64) std::atomic<std::uint64_t> sequence;
+    /**
+     * The number of frames published so far.
+     */
+    std::atomic<std::uint64_t> frame;
+    /**
+     * The size of the current frame, which depends on the resolution the program selected.
+     */
+    std::atomic<std::uint16_t> frame_width;
+    std::atomic<std::uint16_t> frame_height;
+    /**
+     * Two words per row, the most significant bit of the first word being the leftmost pixel.
+     */
+    std::array<std::array<std::atomic<std::uint64_t>, 2u>, HEIGHT> rows;
+
+    alignas(64) std::atomic<std::uint16_t> keys;
+  };
+
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint16_t>::is_always_lock_free,
+      "Atomics in shared memory must be lock-free");
+
+  /**
+   * Read access to the frames exported by a running VM.
+   */
+  class SharedFrameReader final {
+  public:
+    struct Frame final {
+      std::uint64_t number;
+      std::uint16_t width;
+      std::uint16_t height;
+      std::array<std::array<std::uint64_t, 2u>, SharedFrame::HEIGHT> rows;
+
+      [[nodiscard]] bool pixel(std::uint16_t const x, std::uint16_t const y) const noexcept
+      {
+        return ((rows[y][x/64u] >> (63u-x%64u)) & 1u)!=0u;
+      }
+    };
+
+    /**
+     * Open the shared memory segment of a running VM.
+     *
+     * @param name The name of the segment, e.g. "/chip8".
+     * @throws SharedMemoryException if the segment does not exist or has an unknown layout.
+     */
+    explicit SharedFrameReader(std::string const& name);
+
+    SharedFrameReader(SharedFrameReader const&) = delete;
+
+    SharedFrameReader& operator=(SharedFrameReader const&) = delete;
+
+    ~SharedFrameReader() noexcept;
+
+    /**
+     * Read the most recently published frame. Never blocks the VM.
+     *
+     * @return The frame or an empty optional if no consistent frame could be read, because the VM kept writing.
+     */
+    [[nodiscard]] std::optional<Frame> read() const noexcept;
+
+    /**
+     * Press or release a key of the VM.
+     *
+     * @param index The key (0x0-0xF).
+     * @param pressed true, if the key is pressed, false if it is released.
+     */
+    void set_key(std::uint8_t index, bool pressed) noexcept;
+
+  private:
+    SharedFrame* frame_;
+  };
+}
+
+#endif // CHIP8_VM_SHARED_FRAME_HXX
@@ -0,0 +1,77 @@
+#include "shared_memory_screen.hxx"
+
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace chip8 {
+  static_assert(SharedFrame::WIDTH==Screen::HIRES_WIDTH && SharedFrame::HEIGHT==Screen::HIRES_HEIGHT,
+      "Shared frames must fit the high resolution");
+
+  SharedMemoryScreen::SharedMemoryScreen(std::string name)
+      :name_{std::move(name)}
+  {
+    shm_unlink(name_.c_str());
+    auto const fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd<0)
+      throw SharedMemoryException{"Could not create shared memory segment"};
+
+    if (ftruncate(fd, sizeof(SharedFrame))!=0) {
+      ::close(fd);
+      shm_unlink(name_.c_str());
+      throw SharedMemoryException{"Could not resize shared memory segment"};
+    }
+
+    auto const memory = mmap(nullptr, sizeof(SharedFrame), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory==MAP_FAILED) {
+      shm_unlink(name_.c_str());
+      throw SharedMemoryException{"Could not map shared memory segment"};
+    }
+
+    frame_ = new(memory) SharedFrame{
+        .magic = SharedFrame::MAGIC,
+        .version = SharedFrame::VERSION,
+        .width = SharedFrame::WIDTH,
+        .height = SharedFrame::HEIGHT,
+        .sequence = 0u,
+        .frame = 0u,
+        .frame_width = Screen::WIDTH,
+        .frame_height = Screen::HEIGHT,
+        .rows = {},
+        .keys = 0u,
+    };
+  }
+
+  SharedMemoryScreen::~SharedMemoryScreen() noexcept
+  {
+    munmap(frame_, sizeof(SharedFrame));
+    shm_unlink(name_.c_str());
+  }
+
+  bool SharedMemoryScreen::publish() noexcept
+  {
+    auto const version = this->version();
+    if (version==published_version_)
+      return false;
+    published_version_ = version;
+
+    auto const current = frame();
+    auto const sequence = frame_->sequence.load(std::memory_order_relaxed);
+    frame_->sequence.store(sequence+1u, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    frame_->frame_width.store(current.width(), std::memory_order_relaxed);
+    frame_->frame_height.store(current.height(), std::memory_order_relaxed);
+    for (std::size_t y = 0; y<current.rows.size(); ++y) {
+      frame_->rows[y][0].store(current.rows[y].high, std::memory_order_relaxed);
+      frame_->rows[y][1].store(current.rows[y].low, std::memory_order_relaxed);
+    }
+    frame_->frame.store(frame_->frame.load(std::memory_order_relaxed)+1u, std::memory_order_relaxed);
+
+    frame_->sequence.store(sequence+2u, std::memory_order_release);
+    return true;
+  }
+}
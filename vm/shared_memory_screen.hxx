@@ -0,0 +1,75 @@
+#pragma once
+
+#ifndef CHIP8_VM_SHARED_MEMORY_SCREEN_HXX
+#define CHIP8_VM_SHARED_MEMORY_SCREEN_HXX
+
+#include <cstdint>
+#include <string>
+
+#include "packed_screen.hxx"
+#include "shared_frame.hxx"
+
+namespace chip8 {
+  /**
+   * Screen exporting its frames through a POSIX shared memory segment.
+   *
+   * External tools can read the frames with SharedFrameReader without ever blocking the VM
+   * and press keys, which forward_keys() hands to the processor.
+   */
+  class SharedMemoryScreen final : public PackedScreen {
+  public:
+    /**
+     * Create the shared memory segment.
+     *
+     * @param name The name of the segment, e.g. "/chip8". An existing segment of the same name is replaced.
+     * @throws SharedMemoryException if the segment cannot be created.
+     */
+    explicit SharedMemoryScreen(std::string name);
+
+    SharedMemoryScreen(SharedMemoryScreen const&) = delete;
+
+    SharedMemoryScreen& operator=(SharedMemoryScreen const&) = delete;
+
+    /**
+     * Unmaps and removes the shared memory segment.
+     */
+    ~SharedMemoryScreen() noexcept override;
+
+    /**
+     * Copy the current frame into the shared memory segment, if it changed since it was last published.
+     *
+     * Has to be called from the thread running the processor while it is not executing an instruction,
+     * otherwise a frame drawn halfway may be published.
+     *
+     * @return true, if a new frame was published.
+     */
+    bool publish() noexcept;
+
+    /**
+     * Forward the keys changed by consumers since the last call to the processor.
+     *
+     * Calls Processor::toggle_key, so it has to be called from the thread that handles input for the processor.
+     *
+     * @param processor The processor to forward the keys to.
+     */
+    template<typename Processor>
+    void forward_keys(Processor& processor)
+    {
+      auto const keys = frame_->keys.load(std::memory_order_acquire);
+      auto const changed = static_cast<std::uint16_t>(keys ^ forwarded_keys_);
+      for (std::uint8_t index = 0; index<16u; ++index) {
+        if (changed & (1u << index))
+          processor.toggle_key(index, (keys & (1u << index))!=0u);
+      }
+      forwarded_keys_ = keys;
+    }
+
+  private:
+    std::string name_;
+    SharedFrame* frame_{nullptr};
+    std::uint64_t published_version_{0u};
+    std::uint16_t forwarded_keys_{0u};
+  };
+}
+
+#endif // CHIP8_VM_SHARED_MEMORY_SCREEN_HXX
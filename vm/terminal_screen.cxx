@@ -0,0 +1,138 @@
+#include "terminal_screen.hxx"
+
+#include <cerrno>
+#include <string_view>
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace chip8 {
+  namespace {
+    // alternate screen, hidden cursor, cleared screen
+    std::string_view constexpr ENTER = "\x1B[?1049h\x1B[?25l\x1B[2J";
+    std::string_view constexpr CLEAR = "\x1B[2J";
+    std::string_view constexpr LEAVE = "\x1B[?25h\x1B[?1049l";
+
+    // space, lower half block, upper half block and full block in UTF-8,
+    // indexed by (top pixel << 1) | bottom pixel
+    std::array<std::string_view, 4u> constexpr CELLS{" ", "\xE2\x96\x84", "\xE2\x96\x80", "\xE2\x96\x88"};
+
+    // re-sending a few unchanged cells is cheaper than moving the cursor over them
+    int constexpr MAX_SKIPPED_CELLS = 2;
+
+    int cell(FrameBuffer const& frame, int const row, int const column) noexcept
+    {
+      auto const x = static_cast<std::uint8_t>(column);
+      auto const top = frame.pixel(x, static_cast<std::uint8_t>(2*row)) ? 1 : 0;
+      auto const bottom = frame.pixel(x, static_cast<std::uint8_t>(2*row+1)) ? 1 : 0;
+      return (top << 1) | bottom;
+    }
+  }
+
+  TerminalScreen::TerminalScreen(int const fd) noexcept
+      :fd_{fd}
+  {
+    output_.reserve(Screen::HIRES_WIDTH*Screen::HIRES_HEIGHT*4u);
+  }
+
+  TerminalScreen::~TerminalScreen() noexcept
+  {
+    if (started_) {
+      // the terminal has to leave the alternate screen even if it is slow to take the rest of the last frame
+      output_ += LEAVE;
+      write_output(std::chrono::milliseconds{500});
+    }
+  }
+
+  std::size_t TerminalScreen::present()
+  {
+    auto const now = std::chrono::steady_clock::now();
+    if (started_ && now-presented_at_<REFRESH_INTERVAL)
+      return 0u;
+
+    // a frame the terminal only took partially is completed before the next one is encoded against it
+    if (!output_.empty()) {
+      presented_at_ = now;
+      return write_output();
+    }
+
+    if (!started_) {
+      output_ = ENTER;
+      started_ = true;
+    }
+
+    if (auto const version = this->version(); version!=presented_version_) {
+      presented_version_ = version;
+      encode(frame());
+    }
+
+    if (output_.empty())
+      return 0u;
+
+    presented_at_ = now;
+    return write_output();
+  }
+
+  void TerminalScreen::encode(FrameBuffer const& frame)
+  {
+    // the terminal is cleared when switching resolutions, so every cell is new afterwards
+    if (frame.high_resolution!=presented_.high_resolution) {
+      output_ += CLEAR;
+      presented_ = FrameBuffer{.rows = {}, .high_resolution = frame.high_resolution};
+    }
+
+    for (int row = 0; row<frame.height()/2; ++row) {
+      auto const changed = (frame.rows[2*row] ^ presented_.rows[2*row])
+          | (frame.rows[2*row+1] ^ presented_.rows[2*row+1]);
+      if (!changed.any())
+        continue;
+
+      int cursor = -1 - MAX_SKIPPED_CELLS;
+      for (int column = 0; column<frame.width(); ++column) {
+        if (!changed.test(static_cast<std::uint8_t>(column)))
+          continue;
+
+        if (column-cursor>MAX_SKIPPED_CELLS) {
+          output_ += "\x1B[";
+          output_ += std::to_string(row+1);
+          output_ += ';';
+          output_ += std::to_string(column+1);
+          output_ += 'H';
+        }
+        else {
+          for (; cursor<column; ++cursor)
+            output_ += CELLS[cell(frame, row, cursor)];
+        }
+
+        output_ += CELLS[cell(frame, row, column)];
+        cursor = column+1;
+      }
+    }
+    presented_ = frame;
+  }
+
+  std::size_t TerminalScreen::write_output(std::chrono::milliseconds const timeout) noexcept
+  {
+    std::size_t total = 0u;
+    while (written_<output_.size()) {
+      auto const written = ::write(fd_, output_.data()+written_, output_.size()-written_);
+      if (written<0) {
+        if (errno==EINTR)
+          continue;
+        if ((errno==EAGAIN || errno==EWOULDBLOCK) && timeout.count()>0) {
+          pollfd terminal{.fd = fd_, .events = POLLOUT, .revents = 0};
+          if (::poll(&terminal, 1, static_cast<int>(timeout.count()))>0)
+            continue;
+        }
+        // the rest is written by the next call
+        return total;
+      }
+      written_ += static_cast<std::size_t>(written);
+      total += static_cast<std::size_t>(written);
+    }
+
+    output_.clear();
+    written_ = 0u;
+    return total;
+  }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef CHIP8_VM_TERMINAL_SCREEN_HXX
+#define CHIP8_VM_TERMINAL_SCREEN_HXX
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "packed_screen.hxx"
+
+namespace chip8 {
+  /**
+   * Screen rendering to an ANSI terminal.
+   *
+   * Every character cell shows two rows of pixels using Unicode half blocks.
+   * Only the cells that changed since the previous frame are written, so the amount of output
+   * depends on what changed and not on the size of the screen.
+   */
+  class TerminalScreen final : public PackedScreen {
+  public:
+    static auto constexpr REFRESH_INTERVAL = std::chrono::microseconds{16'667};
+
+    /**
+     * Construct a terminal screen.
+     *
+     * @param fd The file descriptor of the terminal, e.g. STDOUT_FILENO.
+     */
+    explicit TerminalScreen(int fd) noexcept;
+
+    TerminalScreen(TerminalScreen const&) = delete;
+
+    TerminalScreen& operator=(TerminalScreen const&) = delete;
+
+    /**
+     * Restores the cursor and leaves the alternate screen, if present() was ever called.
+     */
+    ~TerminalScreen() noexcept override;
+
+    /**
+     * Write the changes since the previous frame to the terminal using a single write.
+     *
+     * Does nothing if called again before REFRESH_INTERVAL has passed. If the terminal does not take the whole
+     * frame, e.g. because it is non-blocking and its buffer is full, the rest is written by the next calls before
+     * any newer frame.
+     *
+     * @return The number of bytes written.
+     */
+    std::size_t present();
+
+  private:
+    int fd_;
+    bool started_{false};
+    std::uint64_t presented_version_{0u};
+    std::chrono::steady_clock::time_point presented_at_{};
+    /**
+     * The frame the terminal shows once all of output_ is written.
+     */
+    FrameBuffer presented_{};
+    std::string output_{};
+    /**
+     * Bytes at the start of output_ the terminal already took.
+     */
+    std::size_t written_{0u};
+
+    void encode(FrameBuffer const& frame);
+
+    /**
+     * Write as much of the pending output as the terminal takes.
+     *
+     * @param timeout How long to wait for a non-blocking terminal to take more output.
+     * @return The number of bytes written.
+     */
+    std::size_t write_output(std::chrono::milliseconds timeout = {}) noexcept;
+  };
+}
+
+#endif // CHIP8_VM_TERMINAL_SCREEN_HXX
@@ -0,0 +1,390 @@
+#include "trace.hxx"
+
+#include <algorithm>
+#include <bit>
+
+namespace chip8 {
+  namespace {
+    std::array<char, 8u> constexpr FILE_MAGIC{'C', '8', 'T', 'R', 0x02, 0x00, 0x00, 0x00};
+
+    // worst case: flags, pc, opcode, registers, index, timers and memory
+    std::size_t constexpr MAX_RECORD_SIZE = 1u+3u+2u+(2u+16u)+3u+2u+(3u+1u+16u);
+
+    enum Flags : std::uint8_t {
+      PC = 0x01,
+      REGISTERS = 0x02,
+      INDEX = 0x04,
+      /**
+       * Either timer changed, both are stored.
+       */
+      TIMERS = 0x08,
+      MEMORY = 0x10,
+      HALTED = 0x20,
+      /**
+       * The opcode differs from the last one executed at the same address in the chunk.
+       */
+      OPCODE = 0x40,
+      /**
+       * Only one register changed, stored as its index and value instead of a mask.
+       */
+      REGISTER = 0x80,
+    };
+
+    std::uint32_t zigzag(int const value) noexcept
+    {
+      return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+    }
+
+    int unzigzag(std::uint32_t const value) noexcept
+    {
+      return static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1u);
+    }
+
+    std::uint8_t* put_varint(std::uint8_t* out, std::uint32_t value) noexcept
+    {
+      while (value>=0x80u) {
+        *out++ = static_cast<std::uint8_t>(value | 0x80u);
+        value >>= 7;
+      }
+      *out++ = static_cast<std::uint8_t>(value);
+      return out;
+    }
+
+    void put_u32(char* out, std::uint32_t const value) noexcept
+    {
+      for (int n = 0; n<4; ++n)
+        out[n] = static_cast<char>(value >> (8*n));
+    }
+
+    std::uint32_t get_u32(char const* in) noexcept
+    {
+      std::uint32_t value = 0u;
+      for (int n = 0; n<4; ++n)
+        value |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(in[n])) << (8*n);
+      return value;
+    }
+
+    /**
+     * Bounds checked cursor over the payload of a chunk.
+     */
+    class Cursor final {
+    public:
+      Cursor(std::vector<std::uint8_t> const& data, std::size_t& offset) noexcept
+          :data_{data}, offset_{offset}
+      {
+      }
+
+      std::uint8_t byte()
+      {
+        if (offset_>=data_.size())
+          throw TraceException{"Trace file is corrupted"};
+        return data_[offset_++];
+      }
+
+      std::uint32_t varint()
+      {
+        std::uint32_t value = 0u;
+        for (int shift = 0; shift<32; shift += 7) {
+          auto const b = byte();
+          value |= static_cast<std::uint32_t>(b & 0x7Fu) << shift;
+          if ((b & 0x80u)==0u)
+            return value;
+        }
+        throw TraceException{"Trace file is corrupted"};
+      }
+
+    private:
+      std::vector<std::uint8_t> const& data_;
+      std::size_t& offset_;
+    };
+  }
+
+  TraceWriter::TraceWriter(std::filesystem::path const& path)
+      :file_{path, std::ios::binary | std::ios::trunc}
+  {
+    if (!file_.write(FILE_MAGIC.data(), FILE_MAGIC.size()))
+      throw TraceException{"Could not create trace file"};
+
+    for (auto& chunk: chunks_) {
+      chunk.data = std::make_unique<std::uint8_t[]>(CHUNK_SIZE);
+      free_.push_back(&chunk);
+    }
+    full_.reserve(CHUNK_COUNT);
+    opcodes_.fill(NO_OPCODE);
+
+    current_ = free_.back();
+    free_.pop_back();
+    thread_ = std::thread{[this] { write_chunks(); }};
+  }
+
+  TraceWriter::~TraceWriter() noexcept
+  {
+    try {
+      close();
+    }
+    catch (...) {
+      // errors can only be reported by calling close() explicitly
+    }
+  }
+
+  void TraceWriter::record(TraceStep const& step)
+  {
+    if (current_==nullptr)
+      return;
+    if (CHUNK_SIZE-current_->size<MAX_RECORD_SIZE)
+      submit_current();
+
+    // a single bounds check per record, the chunk always has room for the largest one
+    auto* const begin = current_->data.get()+current_->size;
+    auto* out = begin+1;
+    std::uint8_t flags = 0u;
+
+    if (step.pc!=previous_pc_+2) {
+      flags |= Flags::PC;
+      out = put_varint(out, zigzag(static_cast<int>(static_cast<std::uint16_t>(step.pc))
+          -static_cast<int>(static_cast<std::uint16_t>(previous_pc_+2))));
+    }
+    previous_pc_ = step.pc;
+
+    // programs rarely modify themselves, so the opcode is usually known from the address already
+    if (auto& opcode = opcodes_[static_cast<std::uint16_t>(step.pc)]; opcode!=step.opcode) {
+      flags |= Flags::OPCODE;
+      opcode = step.opcode;
+      *out++ = static_cast<std::uint8_t>(step.opcode >> 8);
+      *out++ = static_cast<std::uint8_t>(step.opcode);
+    }
+
+    // instructions often write a register with the value it already had, like Dxyn clearing VF again
+    std::uint16_t changed = 0u;
+    for (auto candidates = static_cast<std::uint16_t>(step.written_registers | pending_registers_); candidates!=0u;
+        candidates &= static_cast<std::uint16_t>(candidates-1u)) {
+      auto const index = static_cast<std::size_t>(std::countr_zero(candidates));
+      if (step.v[index]!=known_registers_[index]) {
+        known_registers_[index] = step.v[index];
+        changed |= static_cast<std::uint16_t>(1u << index);
+      }
+    }
+    if (changed!=0u && (changed & (changed-1u))==0u) {
+      // most instructions change a single register, tested by hand as std::has_single_bit becomes a library call on
+      // targets without a popcount instruction
+      flags |= Flags::REGISTER;
+      auto const index = static_cast<std::uint8_t>(std::countr_zero(changed));
+      *out++ = index;
+      *out++ = step.v[index];
+    }
+    else if (changed!=0u) {
+      flags |= Flags::REGISTERS;
+      *out++ = static_cast<std::uint8_t>(changed);
+      *out++ = static_cast<std::uint8_t>(changed >> 8);
+      for (auto remaining = changed; remaining!=0u; remaining &= remaining-1u)
+        *out++ = step.v[static_cast<std::size_t>(std::countr_zero(remaining))];
+    }
+    pending_registers_ = 0u;
+
+    if (step.i!=previous_i_) {
+      flags |= Flags::INDEX;
+      out = put_varint(out, zigzag(static_cast<int>(static_cast<std::uint16_t>(step.i))
+          -static_cast<int>(static_cast<std::uint16_t>(previous_i_))));
+      previous_i_ = step.i;
+    }
+
+    if (step.delay_timer!=previous_delay_timer_ || step.sound_timer!=previous_sound_timer_) {
+      flags |= Flags::TIMERS;
+      *out++ = step.delay_timer;
+      *out++ = step.sound_timer;
+      previous_delay_timer_ = step.delay_timer;
+      previous_sound_timer_ = step.sound_timer;
+    }
+
+    if (step.memory_length>0u) {
+      flags |= Flags::MEMORY;
+      out = put_varint(out, static_cast<std::uint16_t>(step.memory_address));
+      *out++ = step.memory_length;
+      out = std::copy_n(step.memory, step.memory_length, out);
+    }
+
+    if (step.halted)
+      flags |= Flags::HALTED;
+
+    *begin = flags;
+    current_->size += static_cast<std::size_t>(out-begin);
+    ++current_->records;
+  }
+
+  void TraceWriter::close()
+  {
+    if (!thread_.joinable())
+      return;
+
+    {
+      std::lock_guard lock{mutex_};
+      if (current_->records>0u)
+        full_.push_back(current_);
+      current_ = nullptr;
+      closing_ = true;
+    }
+    chunk_available_.notify_all();
+    thread_.join();
+
+    file_.close();
+    if (failed_ || file_.fail())
+      throw TraceException{"Could not write trace file"};
+  }
+
+  void TraceWriter::submit_current()
+  {
+    std::unique_lock lock{mutex_};
+    full_.push_back(current_);
+    chunk_available_.notify_all();
+    chunk_available_.wait(lock, [this] { return !free_.empty(); });
+    current_ = free_.back();
+    free_.pop_back();
+
+    // every chunk can be decoded on its own
+    previous_pc_ = Address{};
+    previous_i_ = Address{};
+    previous_delay_timer_ = 0u;
+    previous_sound_timer_ = 0u;
+    known_registers_ = {};
+    pending_registers_ = 0xFFFFu;
+    opcodes_.fill(NO_OPCODE);
+  }
+
+  void TraceWriter::write_chunks()
+  {
+    std::unique_lock lock{mutex_};
+    while (true) {
+      chunk_available_.wait(lock, [this] { return !full_.empty() || closing_; });
+      if (full_.empty())
+        return;
+
+      auto const chunk = full_.front();
+      full_.erase(full_.begin());
+      lock.unlock();
+
+      if (!failed_) {
+        std::array<char, 8u> header{};
+        put_u32(header.data(), static_cast<std::uint32_t>(chunk->size));
+        put_u32(header.data()+4, chunk->records);
+        file_.write(header.data(), header.size());
+        file_.write(reinterpret_cast<char const*>(chunk->data.get()), static_cast<std::streamsize>(chunk->size));
+      }
+      chunk->size = 0u;
+      chunk->records = 0u;
+
+      lock.lock();
+      failed_ = failed_ || file_.fail();
+      free_.push_back(chunk);
+      chunk_available_.notify_all();
+    }
+  }
+
+  TraceReader::TraceReader(std::filesystem::path const& path)
+      :file_{path, std::ios::binary}
+  {
+    std::array<char, FILE_MAGIC.size()> magic{};
+    if (!file_.read(magic.data(), magic.size()) || magic!=FILE_MAGIC)
+      throw TraceException{"Not a trace file"};
+  }
+
+  std::optional<TraceRecord> TraceReader::next()
+  {
+    while (remaining_==0u) {
+      if (!read_chunk())
+        return {};
+    }
+
+    Cursor in{chunk_, offset_};
+    TraceRecord record = previous_;
+    auto const flags = in.byte();
+
+    auto const expected_pc = static_cast<int>(static_cast<std::uint16_t>(previous_.pc+2));
+    auto const pc = (flags & Flags::PC) ? expected_pc+unzigzag(in.varint()) : expected_pc;
+    record.pc = Address{static_cast<std::uint16_t>(pc), Address::Truncate{}};
+
+    auto& opcode = opcodes_[static_cast<std::uint16_t>(record.pc)];
+    if (flags & Flags::OPCODE) {
+      auto const high = in.byte();
+      opcode = static_cast<std::uint16_t>((high << 8) | in.byte());
+    }
+    else if (opcode==NO_OPCODE) {
+      throw TraceException{"Trace file is corrupted"};
+    }
+    record.opcode = static_cast<std::uint16_t>(opcode);
+
+    if (flags & Flags::REGISTER) {
+      auto const index = in.byte();
+      if (index>=record.v.size())
+        throw TraceException{"Trace file is corrupted"};
+      record.v[index] = in.byte();
+    }
+    else if (flags & Flags::REGISTERS) {
+      auto const low = in.byte();
+      auto const changed = static_cast<std::uint16_t>(low | (in.byte() << 8));
+      for (std::size_t n = 0; n<record.v.size(); ++n) {
+        if (changed & (1u << n))
+          record.v[n] = in.byte();
+      }
+    }
+
+    if (flags & Flags::INDEX) {
+      auto const i = static_cast<int>(static_cast<std::uint16_t>(previous_.i))+unzigzag(in.varint());
+      record.i = Address{static_cast<std::uint16_t>(i), Address::Truncate{}};
+    }
+
+    if (flags & Flags::TIMERS) {
+      record.delay_timer = in.byte();
+      record.sound_timer = in.byte();
+    }
+
+    record.memory_length = 0u;
+    record.memory = {};
+    if (flags & Flags::MEMORY) {
+      record.memory_address = Address{static_cast<std::uint16_t>(in.varint()), Address::Truncate{}};
+      record.memory_length = in.byte();
+      if (record.memory_length>record.memory.size())
+        throw TraceException{"Trace file is corrupted"};
+      for (std::uint8_t n = 0; n<record.memory_length; ++n)
+        record.memory[n] = in.byte();
+    }
+    else {
+      record.memory_address = Address{};
+    }
+
+    record.halted = (flags & Flags::HALTED)!=0u;
+
+    --remaining_;
+    ++position_;
+    previous_ = record;
+    return record;
+  }
+
+  std::uint64_t TraceReader::position() const noexcept
+  {
+    return position_;
+  }
+
+  bool TraceReader::read_chunk()
+  {
+    std::array<char, 8u> header{};
+    if (!file_.read(header.data(), header.size())) {
+      if (file_.gcount()==0)
+        return false;
+      throw TraceException{"Trace file is truncated"};
+    }
+
+    auto const size = get_u32(header.data());
+    if (size>TraceWriter::CHUNK_SIZE)
+      throw TraceException{"Trace file is corrupted"};
+
+    chunk_.resize(size);
+    if (!file_.read(reinterpret_cast<char*>(chunk_.data()), size))
+      throw TraceException{"Trace file is truncated"};
+
+    offset_ = 0u;
+    remaining_ = get_u32(header.data()+4);
+    previous_ = TraceRecord{};
+    opcodes_.fill(NO_OPCODE);
+    return true;
+  }
+}
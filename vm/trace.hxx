@@ -0,0 +1,230 @@
+#pragma once
+
+#ifndef CHIP8_VM_TRACE_HXX
+#define CHIP8_VM_TRACE_HXX
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "address.hxx"
+
+namespace chip8 {
+  /**
+   * Exception class being thrown when a trace file cannot be written or read.
+   *
+   * Even though the class has the same functionality as its base,
+   * it exists for improved readability as it is more specific.
+   */
+  class TraceException final : public std::runtime_error {
+    using std::runtime_error::runtime_error;
+    using std::runtime_error::operator=;
+  };
+
+  /**
+   * The state of the processor after executing a single instruction.
+   *
+   * Only the differences to the previous record end up in the trace file,
+   * the reader reconstructs the full record again.
+   */
+  struct TraceRecord final {
+    /**
+     * Address of the executed instruction.
+     */
+    Address pc{};
+    std::uint16_t opcode{0u};
+    /**
+     * true, if executing the instruction stopped the processor.
+     */
+    bool halted{false};
+    Address i{};
+    std::uint8_t delay_timer{0u};
+    std::uint8_t sound_timer{0u};
+    std::array<std::uint8_t, 16u> v{};
+    /**
+     * Memory written by the instruction, memory_length bytes starting at memory_address.
+     */
+    Address memory_address{};
+    std::uint8_t memory_length{0u};
+    std::array<std::uint8_t, 16u> memory{};
+
+    bool operator==(TraceRecord const&) const noexcept = default;
+  };
+
+  /**
+   * An executed instruction as the processor hands it to TraceWriter.
+   *
+   * Instead of a full copy of the state it only points at the registers and the memory the instruction wrote,
+   * so recording does not have to assemble and compare whole records.
+   */
+  struct TraceStep final {
+    /**
+     * Address of the executed instruction.
+     */
+    Address pc;
+    std::uint16_t opcode;
+    /**
+     * true, if executing the instruction stopped the processor.
+     */
+    bool halted;
+    Address i;
+    std::uint8_t delay_timer;
+    std::uint8_t sound_timer;
+    /**
+     * Bit n is set if the instruction may have written register n. Registers outside the mask must be unchanged.
+     */
+    std::uint16_t written_registers;
+    /**
+     * All 16 registers after executing the instruction.
+     */
+    std::uint8_t const* v;
+    /**
+     * Memory written by the instruction, memory_length bytes starting at memory_address.
+     */
+    Address memory_address;
+    std::uint8_t memory_length;
+    std::uint8_t const* memory;
+  };
+
+  /**
+   * Writes a compact execution trace to a file.
+   *
+   * Records are delta encoded into fixed size chunks, which are handed over to a background thread for writing.
+   * There is only a fixed number of chunks, so when the disk cannot keep up, record() blocks until a chunk
+   * becomes available again instead of using more memory.
+   */
+  class TraceWriter final {
+  public:
+    static std::size_t constexpr CHUNK_SIZE = 64u*1024u;
+    static std::size_t constexpr CHUNK_COUNT = 4u;
+
+    /**
+     * Create the trace file and start the background writer.
+     *
+     * @param path The file to write the trace to. Existing files are overwritten.
+     * @throws TraceException if the file cannot be created.
+     */
+    explicit TraceWriter(std::filesystem::path const& path);
+
+    TraceWriter(TraceWriter const&) = delete;
+
+    TraceWriter& operator=(TraceWriter const&) = delete;
+
+    /**
+     * Flushes all pending records and stops the background writer.
+     */
+    ~TraceWriter() noexcept;
+
+    /**
+     * Append an executed instruction to the trace.
+     *
+     * Must always be called from the same thread. Records appended after close() are dropped.
+     *
+     * @param step The instruction to be appended.
+     */
+    void record(TraceStep const& step);
+
+    /**
+     * Write all pending records and close the file.
+     *
+     * @throws TraceException if writing any of the chunks failed.
+     */
+    void close();
+
+  private:
+    static std::uint32_t constexpr NO_OPCODE = 0x10000u;
+
+    struct Chunk final {
+      std::unique_ptr<std::uint8_t[]> data{};
+      std::size_t size{0u};
+      std::uint32_t records{0u};
+    };
+
+    std::ofstream file_;
+    std::array<Chunk, CHUNK_COUNT> chunks_{};
+
+    // synchronisation with the background thread
+    std::mutex mutex_{};
+    std::condition_variable chunk_available_{};
+    std::vector<Chunk*> free_{};
+    std::vector<Chunk*> full_{};
+    bool closing_{false};
+    bool failed_{false};
+    std::thread thread_;
+
+    // encoder state, only touched by the recording thread
+    Chunk* current_{nullptr};
+    Address previous_pc_{};
+    Address previous_i_{};
+    std::uint8_t previous_delay_timer_{0u};
+    std::uint8_t previous_sound_timer_{0u};
+    /**
+     * The registers as a reader of the current chunk knows them.
+     */
+    std::array<std::uint8_t, 16u> known_registers_{};
+    /**
+     * Registers compared with the next record regardless of the instruction, all of them at the start of a chunk.
+     */
+    std::uint16_t pending_registers_{0xFFFFu};
+    /**
+     * The last opcode executed at every address in the current chunk, NO_OPCODE if none was.
+     */
+    std::array<std::uint32_t, Address::VALUE_MASK+1u> opcodes_{};
+
+    void submit_current();
+
+    void write_chunks();
+  };
+
+  /**
+   * Reads a trace written by TraceWriter record by record.
+   */
+  class TraceReader final {
+  public:
+    /**
+     * Open a trace file.
+     *
+     * @param path The trace file to read.
+     * @throws TraceException if the file cannot be opened or is not a trace file.
+     */
+    explicit TraceReader(std::filesystem::path const& path);
+
+    /**
+     * Read the next record.
+     *
+     * @return The next record or an empty optional at the end of the trace.
+     * @throws TraceException if the trace is corrupted.
+     */
+    std::optional<TraceRecord> next();
+
+    /**
+     * Get the number of records read so far.
+     *
+     * @return The number of records returned by next().
+     */
+    [[nodiscard]] std::uint64_t position() const noexcept;
+
+  private:
+    static std::uint32_t constexpr NO_OPCODE = 0x10000u;
+
+    std::ifstream file_;
+    std::vector<std::uint8_t> chunk_{};
+    std::size_t offset_{0u};
+    std::uint32_t remaining_{0u};
+    std::uint64_t position_{0u};
+    TraceRecord previous_{};
+    std::array<std::uint32_t, Address::VALUE_MASK+1u> opcodes_{};
+
+    bool read_chunk();
+  };
+}
+
+#endif // CHIP8_VM_TRACE_HXX